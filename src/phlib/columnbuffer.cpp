@@ -0,0 +1,89 @@
+/*
+ * columnbuffer.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdlib.h>
+#include	<algorithm>
+#include	<new>
+#include	"columnbuffer.h"
+#ifdef	__linux__
+#include	<sys/mman.h>
+#endif
+
+namespace phlib {
+
+column_buffer::~column_buffer()
+{
+	clear();
+}
+
+void column_buffer::grow(size_type n)
+{
+	static const size_type	chunk = ChunkSize / sizeof(element_type);
+
+	// whole chunks, at least twice as much as before
+	size_type	capacity = std::max(n, 2 * allocated);
+	capacity = (capacity + chunk - 1) / chunk * chunk;
+
+#ifdef	__linux__
+	void*	p = allocated
+		? ::mremap(buffer, allocated * sizeof(element_type), capacity * sizeof(element_type), MREMAP_MAYMOVE)
+		: ::mmap(0, capacity * sizeof(element_type), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (MAP_FAILED == p)
+		throw std::bad_alloc();
+#else	//	__linux__
+	void*	p = ::realloc(buffer, capacity * sizeof(element_type));
+	if (0 == p)
+		throw std::bad_alloc();
+#endif	//	__linux__
+
+	buffer = static_cast<element_type*>(p);
+	allocated = capacity;
+}
+
+void column_buffer::resize(size_type n, element_type v)
+{
+	if (n > allocated)
+		grow(n);
+	if (n > count)
+		std::fill(buffer + count, buffer + n, v);
+	count = n;
+}
+
+void column_buffer::reserve(size_type n)
+{
+	if (n > allocated)
+		grow(n);
+}
+
+void column_buffer::clear()
+{
+	if (buffer) {
+#ifdef	__linux__
+		::munmap(buffer, allocated * sizeof(element_type));
+#else
+		::free(buffer);
+#endif
+	}
+
+	buffer = 0;
+	count = allocated = 0;
+}
+
+void column_buffer::swap(column_buffer& v)
+{
+	std::swap(buffer, v.buffer);
+	std::swap(count, v.count);
+	std::swap(allocated, v.allocated);
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+ * columnbuffer.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_COLUMNBUFFER_H_102938475657483920193847
+#define	__MD_COLUMNBUFFER_H_102938475657483920193847
+
+#include	<stddef.h>
+#include	"vectorexpr.hpp"
+#include	"floatvector.h"
+
+namespace phlib {
+
+// Growable contiguous array of doubles.
+// On Linux memory grows by remapping pages with mremap(), so elements are
+// never copied when the buffer grows; elsewhere realloc() is used.
+// Data is passed to vector kernels through data() and size() and to vector
+// expressions through make_operand(), both without copying.
+class column_buffer {
+public:
+	typedef double	element_type;
+	typedef size_t	size_type;
+	typedef element_type*	iterator;
+	typedef const element_type*	const_iterator;
+
+	enum {ChunkSize = 1024 * 1024};	// minimal growth, in bytes
+
+	inline column_buffer() : buffer(0), count(0), allocated(0) {}
+	~column_buffer();
+
+	inline size_type size() const {
+		return count;
+	}
+	inline size_type capacity() const {
+		return allocated;
+	}
+	inline bool empty() const {
+		return 0 == count;
+	}
+
+	inline element_type* data() {
+		return buffer;
+	}
+	inline const element_type* data() const {
+		return buffer;
+	}
+
+	inline iterator begin() {
+		return buffer;
+	}
+	inline iterator end() {
+		return buffer + count;
+	}
+	inline const_iterator begin() const {
+		return buffer;
+	}
+	inline const_iterator end() const {
+		return buffer + count;
+	}
+
+	inline element_type& operator[](size_type i) {
+		return buffer[i];
+	}
+	inline element_type operator[](size_type i) const {
+		return buffer[i];
+	}
+
+	inline void push_back(element_type v) {
+		if (count == allocated)
+			grow(count + 1);
+		buffer[count++] = v;
+	}
+
+	void resize(size_type n, element_type v = 0.0);
+	void reserve(size_type n);
+	void clear();	// releases memory
+	void swap(column_buffer&);
+
+	// copy of column data
+	float_vector vector() const;
+
+private:
+	element_type*	buffer;
+	size_type	count, allocated;
+
+	void grow(size_type n);
+
+	column_buffer(const column_buffer&);
+	column_buffer& operator=(const column_buffer&);
+};
+
+inline vector_terminal make_operand(const column_buffer& v)
+{
+	return vector_terminal(v.data(), v.size());
+}
+
+inline float_vector column_buffer::vector() const
+{
+	return float_vector(make_operand(*this));
+}
+
+}
+
+#endif	//	__MD_COLUMNBUFFER_H_102938475657483920193847
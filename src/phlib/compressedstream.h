@@ -0,0 +1,90 @@
+/*
+ * compressedstream.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_COMPRESSEDSTREAM_H_283746501928374650192837
+#define	__MD_COMPRESSEDSTREAM_H_283746501928374650192837
+
+#include	<string>
+#include	<fstream>
+#include	"tracestream.h"
+#include	"compression.h"
+
+namespace phlib {
+
+	// TraceStream writing files named *.gz or *.zst compressed on a separate
+	// thread, other files are written as is. "+name" appends a new gzip
+	// member or zstd frame. Compressed file is complete only when the stream
+	// is closed or destroyed, flushing it through std::ostream does not
+	// force compression. See compression.h for libraries to link with.
+	class CompressedTraceStream : protected FileChecker, public std::ostream {
+
+		std::filebuf	file;
+		CompressingBuf	compressed;
+
+		void checkAndOpen(const std::string& fileName, bool do_open, int level) {
+			if (do_open) {
+				std::ios_base::openmode mode = getFileOpenMode(fileName);
+				if (mode != 0) {
+					std::string name = getFileName(fileName);
+					if (name.size() > 0) {
+						Compression format = compressionByName(name.c_str());
+						if (format == compressionGzip || format == compressionZstd) {
+							if (compressed.open(name.c_str(), format, level, mode == std::ios_base::app, true))
+								rdbuf(&compressed);
+							else
+								setstate(std::ios_base::failbit);
+						}
+						else if (!file.open(name.c_str(), mode | std::ios_base::out))
+							setstate(std::ios_base::failbit);
+					}
+				}
+			}
+		}
+
+		CompressedTraceStream(const CompressedTraceStream&);
+		CompressedTraceStream& operator=(const CompressedTraceStream&);
+
+	public:
+
+		// <compressionLevel> of gzip or zstd files, 0 means default one
+		explicit CompressedTraceStream(const std::string& fileName, bool do_open = true, int compressionLevel = 0)
+				: FileChecker(fileName), std::ostream(0) {
+			rdbuf(&file);
+			checkAndOpen(fileName, do_open, compressionLevel);
+		}
+
+		~CompressedTraceStream() {
+			close();
+		}
+
+		inline bool isHeaderRequired() const {
+			return isNew() || getInitialFileSize() == 0;
+		}
+
+		inline bool is_open() const {
+			return compressed.isOpen() || file.is_open();
+		}
+
+		void close() {
+			if (compressed.isOpen()) {
+				if (!compressed.close())
+					setstate(std::ios_base::failbit);
+			}
+			else if (file.is_open() && !file.close())
+				setstate(std::ios_base::failbit);
+		}
+	};
+
+}
+
+#endif	//	__MD_COMPRESSEDSTREAM_H_283746501928374650192837
@@ -0,0 +1,1100 @@
+/*
+ * compression.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<ctype.h>
+#include	<limits.h>
+#include	<algorithm>
+#include	<memory>
+#include	<errno.h>
+#include	<fcntl.h>
+#ifdef	_MSC_VER
+#include	<io.h>
+#else
+#include	<unistd.h>
+#include	<poll.h>
+#endif
+#include	<zlib.h>
+#ifdef	PHLIB_HAVE_ZSTD
+#include	<zstd.h>
+#endif
+#include	"compression.h"
+#include	"thread.h"
+
+namespace phlib {
+
+Compression compressionByName(const char* filename)
+{
+	static const struct {
+		const char*	extension;
+		Compression	format;
+	} known[] = {
+		{".zip", compressionZip},
+		{".gz", compressionGzip},
+		{".zst", compressionZstd}
+	};
+
+	const char	*p = ::strrchr(filename, '.');
+	if (0 == p)
+		return compressionNone;
+
+	for (size_t i = 0; i < sizeof(known) / sizeof(*known); i++) {
+		const char	*a = p, *b = known[i].extension;
+		while (*a && ::tolower(static_cast<unsigned char>(*a)) == *b)
+			a++, b++;
+		if (!*a && !*b)
+			return known[i].format;
+	}
+
+	return compressionNone;
+}
+
+bool isCompressionSupported(Compression format)
+{
+#ifndef	PHLIB_HAVE_ZSTD
+	if (compressionZstd == format)
+		return false;
+#endif
+	return true;
+}
+
+// decoder of particular format
+class DecompressionSource {
+public:
+	virtual ~DecompressionSource() {}
+
+	// returns number of bytes stored at <dest>, 0 at the end of data or on error
+	virtual size_t read(char* dest, size_t size) = 0;
+	virtual bool failed() const = 0;
+
+	// makes read() blocked in another thread, and all later ones, return 0
+	virtual void cancel() {}
+};
+
+///////////////////////////////////////////
+//
+// uncompressed data of files, pipes and terminals
+//
+///////////////////////////////////////////
+
+class DescriptorSource : public DecompressionSource {
+	int	fd;
+	bool	owned;	// descriptor is closed with the source
+	bool	error;
+#ifndef	_MSC_VER
+	int	wakeup[2];	// pipe becoming readable on cancel()
+#endif
+
+public:
+	DescriptorSource() : fd(-1), owned(false), error(false) {
+#ifndef	_MSC_VER
+		if (0 != ::pipe(wakeup))
+			wakeup[0] = wakeup[1] = -1;
+#endif
+	}
+
+	virtual ~DescriptorSource() {
+		if (owned) {
+#ifdef	_MSC_VER
+			::_close(fd);
+#else
+			::close(fd);
+#endif
+		}
+#ifndef	_MSC_VER
+		if (wakeup[0] >= 0) {
+			::close(wakeup[0]);
+			::close(wakeup[1]);
+		}
+#endif
+	}
+
+	bool open(const char* filename) {
+#ifdef	_MSC_VER
+		fd = ::_open(filename, _O_RDONLY | _O_BINARY);
+#else
+		fd = ::open(filename, O_RDONLY);
+#endif
+		owned = fd >= 0;
+		return owned;
+	}
+
+	void attach(int descriptor) {
+		fd = descriptor;
+		owned = false;
+	}
+
+	virtual size_t read(char* dest, size_t size) {
+		if (error)
+			return 0;
+
+		for (;;) {
+#ifdef	_MSC_VER
+			const int	n = ::_read(fd, dest, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+#else
+			// waits for data or cancel()
+			if (wakeup[0] >= 0) {
+				pollfd	fds[2] = {{fd, POLLIN, 0}, {wakeup[0], POLLIN, 0}};
+				if (::poll(fds, 2, -1) < 0) {
+					if (EINTR == errno)
+						continue;
+					error = true;
+					return 0;
+				}
+				if (fds[1].revents)
+					return 0;
+			}
+
+			const ssize_t	n = ::read(fd, dest, size);
+#endif
+			if (n >= 0)
+				return n;
+			if (EINTR != errno) {
+				error = true;
+				return 0;
+			}
+		}
+	}
+
+	virtual bool failed() const {
+		return error;
+	}
+
+	virtual void cancel() {
+#ifndef	_MSC_VER
+		// the byte is never read, the pipe stays readable
+		if (wakeup[1] >= 0) {
+			const ssize_t	n = ::write(wakeup[1], "", 1);
+			(void) n;
+		}
+#endif
+	}
+};
+
+///////////////////////////////////////////
+//
+// gzip files, including concatenated ones
+//
+///////////////////////////////////////////
+
+class GzipSource : public DecompressionSource {
+	gzFile	file;
+	bool	error;
+
+public:
+	GzipSource() : file(0), error(false) {}
+
+	virtual ~GzipSource() {
+		if (file)
+			::gzclose(file);
+	}
+
+	bool open(const char* filename) {
+		file = ::gzopen(filename, "rb");
+		if (file)
+			::gzbuffer(file, 256 * 1024);
+		return 0 != file;
+	}
+
+	virtual size_t read(char* dest, size_t size) {
+		if (error)
+			return 0;
+
+		const int	n = ::gzread(file, dest, static_cast<unsigned>(size));
+		if (n <= 0) {
+			// truncated file is reported at its end
+			int	code;
+			::gzerror(file, &code);
+			error = n < 0 || Z_OK != code;
+			return 0;
+		}
+		return n;
+	}
+
+	virtual bool failed() const {
+		return error;
+	}
+};
+
+///////////////////////////////////////////
+//
+// zip archives, read sequentially by local headers
+//
+///////////////////////////////////////////
+
+class ZipSource : public DecompressionSource {
+	enum {
+		InputSize = 256 * 1024,
+		LocalHeaderSize = 30
+	};
+
+	enum {
+		LocalHeaderSignature = 0x04034b50,
+		DescriptorSignature = 0x08074b50,
+		CentralHeaderSignature = 0x02014b50,
+		EndSignature = 0x06054b50,
+		Zip64EndSignature = 0x06064b50
+	};
+
+	enum State {stateHeader, stateStored, stateDeflated, stateEnd};
+
+	FILE*	file;
+	std::vector<unsigned char>	input;
+	const unsigned char*	next;	// first unread byte of input
+	size_t	available;
+	z_stream	stream;
+	bool	streamReady;
+	State	state;
+	bool	descriptor;	// entry data is followed by data descriptor
+	unsigned long long	storedLeft;
+	bool	error;
+
+	static inline unsigned get16(const unsigned char* p) {
+		return p[0] | (p[1] << 8);
+	}
+
+	static inline unsigned long get32(const unsigned char* p) {
+		return get16(p) | (static_cast<unsigned long>(get16(p + 2)) << 16);
+	}
+
+	static inline unsigned long long get64(const unsigned char* p) {
+		return get32(p) | (static_cast<unsigned long long>(get32(p + 4)) << 32);
+	}
+
+	// reads more input keeping unread bytes, returns false if nothing is added
+	bool fill() {
+		if (available && next != &input[0])
+			::memmove(&input[0], next, available);
+		next = &input[0];
+
+		const size_t	n = ::fread(&input[available], 1, input.size() - available, file);
+		available += n;
+		return n > 0;
+	}
+
+	bool ensure(size_t n) {
+		while (available < n)
+			if (!fill())
+				return false;
+		return true;
+	}
+
+	bool skip(unsigned long long n) {
+		while (n > 0) {
+			if (!available && !fill())
+				return false;
+			const size_t	k = static_cast<size_t>(std::min<unsigned long long>(n, available));
+			next += k;
+			available -= k;
+			n -= k;
+		}
+		return true;
+	}
+
+	bool startEntry() {
+		if (!ensure(4))
+			return false;
+		if (LocalHeaderSignature != get32(next)) {
+			// central directory follows the last entry
+			state = stateEnd;
+			return true;
+		}
+
+		if (!ensure(LocalHeaderSize))
+			return false;
+
+		const unsigned	flags = get16(next + 6);
+		const unsigned	method = get16(next + 8);
+		unsigned long long	compressed = get32(next + 18);
+		const unsigned long	uncompressed = get32(next + 22);
+		const unsigned	nameLength = get16(next + 26);
+		const unsigned	extraLength = get16(next + 28);
+		skip(LocalHeaderSize);
+
+		// encrypted entries are not supported
+		if (flags & 1)
+			return false;
+		descriptor = 0 != (flags & 8);
+
+		if (!ensure(nameLength + extraLength))
+			return false;
+
+		if (0xFFFFFFFFUL == compressed) {
+			// zip64 sizes are stored in extra field
+			const unsigned char	*p = next + nameLength, *end = p + extraLength;
+			while (end - p >= 4) {
+				const unsigned	id = get16(p), size = get16(p + 2);
+				p += 4;
+				if (1 == id) {
+					const unsigned	offset = 0xFFFFFFFFUL == uncompressed ? 8 : 0;
+					if (size >= offset + 8 && static_cast<unsigned>(end - p) >= offset + 8)
+						compressed = get64(p + offset);
+					break;
+				}
+				p += size;
+			}
+		}
+		skip(nameLength + extraLength);
+
+		switch (method) {
+			case 0:
+				// size of stored data must be known in advance
+				if (descriptor)
+					return false;
+				storedLeft = compressed;
+				state = stateStored;
+				return true;
+
+			case Z_DEFLATED:
+				if (Z_OK != ::inflateReset(&stream))
+					return false;
+				state = stateDeflated;
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	bool skipDescriptor() {
+		if (!ensure(4))
+			return false;
+		if (DescriptorSignature == get32(next))
+			skip(4);
+
+		// CRC and 32-bit sizes, zip64 sizes are 64-bit
+		if (!skip(12))
+			return false;
+		if (ensure(4)) {
+			const unsigned long	signature = get32(next);
+			if (LocalHeaderSignature != signature && CentralHeaderSignature != signature
+					&& EndSignature != signature && Zip64EndSignature != signature)
+				return skip(8);
+		}
+		return true;
+	}
+
+public:
+	ZipSource() : file(0), input(InputSize), next(&input[0]), available(0),
+			streamReady(false), state(stateHeader), descriptor(false), storedLeft(0), error(false) {
+		::memset(&stream, 0, sizeof(stream));
+	}
+
+	virtual ~ZipSource() {
+		if (streamReady)
+			::inflateEnd(&stream);
+		if (file)
+			::fclose(file);
+	}
+
+	bool open(const char* filename) {
+		// raw deflate data without zlib header
+		streamReady = Z_OK == ::inflateInit2(&stream, -MAX_WBITS);
+		if (!streamReady)
+			return false;
+
+		file = ::fopen(filename, "rb");
+		return 0 != file;
+	}
+
+	virtual size_t read(char* dest, size_t size) {
+		size_t	done = 0;
+
+		while (done < size && !error && stateEnd != state) {
+			switch (state) {
+				case stateHeader:
+					error = !startEntry();
+					break;
+
+				case stateStored: {
+					if (0 == storedLeft) {
+						state = stateHeader;
+						break;
+					}
+					if (!available && !fill()) {
+						error = true;
+						break;
+					}
+
+					const size_t	n = static_cast<size_t>(std::min<unsigned long long>(
+							std::min(size - done, available), storedLeft));
+					::memcpy(dest + done, next, n);
+					next += n;
+					available -= n;
+					storedLeft -= n;
+					done += n;
+					break;
+				}
+
+				case stateDeflated: {
+					if (!available && !fill()) {
+						error = true;
+						break;
+					}
+
+					stream.next_in = const_cast<Bytef*>(next);
+					stream.avail_in = static_cast<uInt>(available);
+					stream.next_out = reinterpret_cast<Bytef*>(dest + done);
+					stream.avail_out = static_cast<uInt>(size - done);
+
+					const int	rc = ::inflate(&stream, Z_NO_FLUSH);
+
+					next += available - stream.avail_in;
+					available = stream.avail_in;
+					done = size - stream.avail_out;
+
+					if (Z_STREAM_END == rc) {
+						error = descriptor && !skipDescriptor();
+						state = stateHeader;
+					}
+					else if (Z_OK != rc)
+						error = true;
+					break;
+				}
+
+				default:
+					break;
+			}
+		}
+
+		return done;
+	}
+
+	virtual bool failed() const {
+		return error;
+	}
+};
+
+#ifdef	PHLIB_HAVE_ZSTD
+
+///////////////////////////////////////////
+//
+// zstd files, including multiple frames
+//
+///////////////////////////////////////////
+
+class ZstdSource : public DecompressionSource {
+	FILE*	file;
+	ZSTD_DStream*	stream;
+	std::vector<char>	input;
+	ZSTD_inBuffer	in;
+	size_t	lastResult;	// 0 when frame is complete
+	bool	error;
+
+public:
+	ZstdSource() : file(0), stream(0), input(ZSTD_DStreamInSize()), lastResult(0), error(false) {
+		in.src = &input[0];
+		in.size = in.pos = 0;
+	}
+
+	virtual ~ZstdSource() {
+		if (stream)
+			::ZSTD_freeDStream(stream);
+		if (file)
+			::fclose(file);
+	}
+
+	bool open(const char* filename) {
+		stream = ::ZSTD_createDStream();
+		if (!stream || ::ZSTD_isError(::ZSTD_initDStream(stream)))
+			return false;
+
+		file = ::fopen(filename, "rb");
+		return 0 != file;
+	}
+
+	virtual size_t read(char* dest, size_t size) {
+		ZSTD_outBuffer	out = {dest, size, 0};
+
+		while (!error && out.pos < out.size) {
+			if (in.pos == in.size) {
+				const size_t	n = ::fread(&input[0], 1, input.size(), file);
+				if (0 == n) {
+					// file ends in the middle of a frame
+					error = 0 != lastResult;
+					break;
+				}
+				in.size = n;
+				in.pos = 0;
+			}
+
+			lastResult = ::ZSTD_decompressStream(stream, &out, &in);
+			error = ::ZSTD_isError(lastResult);
+		}
+
+		return out.pos;
+	}
+
+	virtual bool failed() const {
+		return error;
+	}
+};
+
+#endif	//	PHLIB_HAVE_ZSTD
+
+///////////////////////////////////////////
+//
+// DecompressingBuf::Prefetcher members
+//
+///////////////////////////////////////////
+
+// decompresses blocks on a separate thread while the reader consumes previous ones
+class DecompressingBuf::Prefetcher : public Runnable {
+	enum {Blocks = 3};
+
+	DecompressionSource&	source;
+	std::vector<char>	blocks[Blocks];
+	size_t	sizes[Blocks];
+	size_t	head, count;	// first filled block and number of filled blocks
+	bool	holding;	// block at <head> is being consumed
+	bool	stopping;
+	Mutex	mutex;
+	Condition	changed;
+	Thread	thread;
+
+public:
+	Prefetcher(DecompressionSource& source) : source(source), head(0), count(0),
+			holding(false), stopping(false) {
+		for (int i = 0; i < Blocks; i++)
+			blocks[i].resize(BlockSize);
+		thread.start(*this);
+	}
+
+	virtual ~Prefetcher() {
+		{
+			ScopedLock	lock(mutex);
+			stopping = true;
+			changed.broadcast();
+		}
+		// the thread may wait for data of a pipe
+		source.cancel();
+		thread.join();
+	}
+
+	virtual void run() {
+		for (size_t tail = 0; ; tail = (tail + 1) % Blocks) {
+			{
+				ScopedLock	lock(mutex);
+				while (Blocks == count && !stopping)
+					changed.wait(mutex);
+				if (stopping)
+					return;
+			}
+
+			// data is passed as soon as it is read, pipes do not wait for full block
+			const size_t	n = source.read(&blocks[tail][0], BlockSize);
+
+			ScopedLock	lock(mutex);
+			sizes[tail] = n;
+			count++;
+			changed.broadcast();
+
+			// empty block marks the end of data
+			if (0 == n)
+				return;
+		}
+	}
+
+	// releases previous block and returns the next one, <size> is 0 at the end of data
+	char* next(size_t& size) {
+		ScopedLock	lock(mutex);
+
+		if (holding && sizes[head] > 0) {
+			head = (head + 1) % Blocks;
+			count--;
+			holding = false;
+			changed.broadcast();
+		}
+
+		while (0 == count)
+			changed.wait(mutex);
+
+		holding = true;
+		size = sizes[head];
+		return &blocks[head][0];
+	}
+};
+
+///////////////////////////////////////////
+//
+// DecompressingBuf members
+//
+///////////////////////////////////////////
+
+DecompressingBuf::DecompressingBuf() : source(0), prefetcher(0)
+{
+	setg(0, 0, 0);
+}
+
+DecompressingBuf::~DecompressingBuf()
+{
+	close();
+}
+
+bool DecompressingBuf::open(const char* filename, Compression format, bool background)
+{
+	close();
+
+	switch (format) {
+		case compressionZip: {
+			std::auto_ptr<ZipSource>	s(new ZipSource);
+			if (!s->open(filename))
+				return false;
+			source = s.release();
+			break;
+		}
+
+		case compressionGzip: {
+			std::auto_ptr<GzipSource>	s(new GzipSource);
+			if (!s->open(filename))
+				return false;
+			source = s.release();
+			break;
+		}
+
+#ifdef	PHLIB_HAVE_ZSTD
+		case compressionZstd: {
+			std::auto_ptr<ZstdSource>	s(new ZstdSource);
+			if (!s->open(filename))
+				return false;
+			source = s.release();
+			break;
+		}
+#endif	//	PHLIB_HAVE_ZSTD
+
+		case compressionNone: {
+			std::auto_ptr<DescriptorSource>	s(new DescriptorSource);
+			if (!s->open(filename))
+				return false;
+			source = s.release();
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	return start(background);
+}
+
+bool DecompressingBuf::open(int descriptor, bool background)
+{
+	close();
+
+	DescriptorSource*	s = new DescriptorSource;
+	s->attach(descriptor);
+	source = s;
+
+	return start(background);
+}
+
+// source is open, prepares buffers
+bool DecompressingBuf::start(bool background)
+{
+#ifndef	_MSC_VER
+	// threads are not available with MSVC, see thread.h
+	if (background) {
+		try {
+			prefetcher = new Prefetcher(*source);
+		}
+		catch (...) {
+			close();
+			throw;
+		}
+	}
+	else
+#endif	//	_MSC_VER
+		buffer.resize(BlockSize);
+
+	return true;
+}
+
+void DecompressingBuf::close()
+{
+	// prefetcher uses the source
+	delete prefetcher;
+	prefetcher = 0;
+	delete source;
+	source = 0;
+
+	setg(0, 0, 0);
+}
+
+bool DecompressingBuf::failed() const
+{
+	return source && source->failed();
+}
+
+DecompressingBuf::int_type DecompressingBuf::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+	if (!source)
+		return traits_type::eof();
+
+	char*	p;
+	size_t	n;
+	if (prefetcher)
+		p = prefetcher->next(n);
+	else {
+		p = &buffer[0];
+		n = source->read(p, buffer.size());
+	}
+
+	if (0 == n)
+		return traits_type::eof();
+
+	setg(p, p, p + n);
+	return traits_type::to_int_type(*p);
+}
+
+///////////////////////////////////////////
+//
+// compressed output
+//
+///////////////////////////////////////////
+
+// encoder of particular format
+class CompressionSink {
+public:
+	virtual ~CompressionSink() {}
+
+	// false on error
+	virtual bool write(const char* data, size_t size) = 0;
+	// completes compressed data, false on error
+	virtual bool finish() = 0;
+};
+
+// appended data makes a new gzip member
+class GzipSink : public CompressionSink {
+	gzFile	file;
+
+public:
+	GzipSink() : file(0) {}
+
+	virtual ~GzipSink() {
+		finish();
+	}
+
+	bool open(const char* filename, int level, bool append) {
+		char	mode[4] = {append ? 'a' : 'w', 'b', 0, 0};
+		if (level > 0)
+			mode[2] = static_cast<char>('0' + std::min(level, 9));
+
+		file = ::gzopen(filename, mode);
+		if (file)
+			::gzbuffer(file, 256 * 1024);
+		return 0 != file;
+	}
+
+	virtual bool write(const char* data, size_t size) {
+		while (size > 0) {
+			const unsigned	n = static_cast<unsigned>(std::min<size_t>(size, INT_MAX));
+			if (::gzwrite(file, data, n) != static_cast<int>(n))
+				return false;
+			data += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	virtual bool finish() {
+		if (!file)
+			return true;
+		const int	code = ::gzclose(file);
+		file = 0;
+		return Z_OK == code;
+	}
+};
+
+#ifdef	PHLIB_HAVE_ZSTD
+
+// appended data makes a new zstd frame
+class ZstdSink : public CompressionSink {
+	FILE*	file;
+	ZSTD_CStream*	stream;
+	std::vector<char>	output;
+
+	bool drain(ZSTD_outBuffer& out) {
+		const bool	ok = ::fwrite(out.dst, 1, out.pos, file) == out.pos;
+		out.pos = 0;
+		return ok;
+	}
+
+public:
+	ZstdSink() : file(0), stream(0), output(ZSTD_CStreamOutSize()) {}
+
+	virtual ~ZstdSink() {
+		finish();
+	}
+
+	bool open(const char* filename, int level, bool append) {
+		stream = ::ZSTD_createCStream();
+		if (!stream || ::ZSTD_isError(::ZSTD_initCStream(stream, level > 0 ? level : 3)))
+			return false;
+
+		file = ::fopen(filename, append ? "ab" : "wb");
+		return 0 != file;
+	}
+
+	virtual bool write(const char* data, size_t size) {
+		ZSTD_inBuffer	in = {data, size, 0};
+		ZSTD_outBuffer	out = {&output[0], output.size(), 0};
+
+		while (in.pos < in.size) {
+			if (::ZSTD_isError(::ZSTD_compressStream(stream, &out, &in)) || !drain(out))
+				return false;
+		}
+		return true;
+	}
+
+	virtual bool finish() {
+		if (!file)
+			return true;
+
+		ZSTD_outBuffer	out = {&output[0], output.size(), 0};
+		bool	ok = true;
+		for (size_t left = 1; ok && left > 0; ) {
+			left = ::ZSTD_endStream(stream, &out);
+			ok = !::ZSTD_isError(left) && drain(out);
+		}
+
+		ok = 0 == ::fclose(file) && ok;
+		file = 0;
+		::ZSTD_freeCStream(stream);
+		stream = 0;
+		return ok;
+	}
+};
+
+#endif	//	PHLIB_HAVE_ZSTD
+
+///////////////////////////////////////////
+//
+// CompressingBuf::Compressor members
+//
+///////////////////////////////////////////
+
+// compresses blocks on a separate thread while the writer fills next ones
+class CompressingBuf::Compressor : public Runnable {
+	enum {Blocks = 3};
+
+	CompressionSink&	sink;
+	std::vector<char>	blocks[Blocks];
+	size_t	sizes[Blocks];
+	size_t	head, tail, count;	// first filled block, block being filled, number of filled blocks
+	bool	stopping;
+	bool	failure;
+	Mutex	mutex;
+	Condition	changed;
+	Thread	thread;
+
+public:
+	Compressor(CompressionSink& sink) : sink(sink), head(0), tail(0), count(0),
+			stopping(false), failure(false) {
+		for (int i = 0; i < Blocks; i++)
+			blocks[i].resize(BlockSize);
+		thread.start(*this);
+	}
+
+	virtual ~Compressor() {
+		finish();
+	}
+
+	virtual void run() {
+		for (;;) {
+			const char*	p;
+			size_t	n;
+			{
+				ScopedLock	lock(mutex);
+				while (0 == count && !stopping)
+					changed.wait(mutex);
+				if (0 == count)
+					return;
+				p = &blocks[head][0];
+				n = sizes[head];
+			}
+
+			// after an error blocks are dropped, the writer must not wait
+			const bool	ok = failure || sink.write(p, n);
+
+			ScopedLock	lock(mutex);
+			if (!ok)
+				failure = true;
+			head = (head + 1) % Blocks;
+			count--;
+			changed.broadcast();
+		}
+	}
+
+	inline char* block() {
+		return &blocks[tail][0];
+	}
+
+	// passes <size> bytes of the current block for compression and returns
+	// the next block, waits while all blocks are filled
+	char* submit(size_t size) {
+		ScopedLock	lock(mutex);
+
+		sizes[tail] = size;
+		count++;
+		changed.broadcast();
+		tail = (tail + 1) % Blocks;
+
+		while (Blocks == count)
+			changed.wait(mutex);
+		return &blocks[tail][0];
+	}
+
+	// compresses all filled blocks and stops the thread
+	void finish() {
+		{
+			ScopedLock	lock(mutex);
+			stopping = true;
+			changed.broadcast();
+		}
+		thread.join();
+	}
+
+	bool failed() {
+		ScopedLock	lock(mutex);
+		return failure;
+	}
+};
+
+///////////////////////////////////////////
+//
+// CompressingBuf members
+//
+///////////////////////////////////////////
+
+CompressingBuf::CompressingBuf() : sink(0), compressor(0), error(false)
+{
+	setp(0, 0);
+}
+
+CompressingBuf::~CompressingBuf()
+{
+	close();
+}
+
+bool CompressingBuf::open(const char* filename, Compression format, int level, bool append, bool background)
+{
+	close();
+	error = false;
+
+	switch (format) {
+		case compressionGzip: {
+			std::auto_ptr<GzipSink>	s(new GzipSink);
+			if (!s->open(filename, level, append))
+				return false;
+			sink = s.release();
+			break;
+		}
+
+#ifdef	PHLIB_HAVE_ZSTD
+		case compressionZstd: {
+			std::auto_ptr<ZstdSink>	s(new ZstdSink);
+			if (!s->open(filename, level, append))
+				return false;
+			sink = s.release();
+			break;
+		}
+#endif	//	PHLIB_HAVE_ZSTD
+
+		default:
+			return false;
+	}
+
+#ifndef	_MSC_VER
+	// threads are not available with MSVC, see thread.h
+	if (background) {
+		try {
+			compressor = new Compressor(*sink);
+		}
+		catch (...) {
+			close();
+			throw;
+		}
+		setp(compressor->block(), compressor->block() + BlockSize);
+		return true;
+	}
+#endif	//	_MSC_VER
+
+	buffer.resize(BlockSize);
+	setp(&buffer[0], &buffer[0] + buffer.size());
+	return true;
+}
+
+bool CompressingBuf::close()
+{
+	if (!sink)
+		return !error;
+
+	writeBlock();
+
+	if (compressor) {
+		compressor->finish();
+		if (compressor->failed())
+			error = true;
+		delete compressor;
+		compressor = 0;
+	}
+
+	if (!sink->finish())
+		error = true;
+	delete sink;
+	sink = 0;
+
+	setp(0, 0);
+	return !error;
+}
+
+bool CompressingBuf::failed() const
+{
+	return error || (compressor && compressor->failed());
+}
+
+// passes buffered data to compression
+bool CompressingBuf::writeBlock()
+{
+	const size_t	size = pptr() - pbase();
+	if (0 == size)
+		return !error;
+
+	if (compressor) {
+		char*	p = compressor->submit(size);
+		setp(p, p + BlockSize);
+	}
+	else {
+		if (!error && !sink->write(pbase(), size))
+			error = true;
+		setp(&buffer[0], &buffer[0] + buffer.size());
+	}
+	return !error;
+}
+
+CompressingBuf::int_type CompressingBuf::overflow(int_type c)
+{
+	if (!sink || !writeBlock())
+		return traits_type::eof();
+
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+}
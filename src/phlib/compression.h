@@ -0,0 +1,136 @@
+/*
+ * compression.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Compressed files are handled by zlib, so applications have to be linked
+ * with -lz. zstd support is built only when PHLIB_HAVE_ZSTD is defined,
+ * then -lzstd is required as well. Files are written in gzip and zstd
+ * formats, zip archives are only read.
+ */
+
+#ifndef	__MD_COMPRESSION_H_918273645501928374655019
+#define	__MD_COMPRESSION_H_918273645501928374655019
+
+#include	<stddef.h>
+#include	<streambuf>
+#include	<vector>
+
+namespace phlib {
+
+enum Compression {
+	compressionNone,
+	compressionZip,
+	compressionGzip,
+	compressionZstd
+};
+
+// guess format by file name extension: .zip, .gz or .zst in any letter case
+Compression compressionByName(const char* filename);
+
+// false if library is built without support of <format>
+bool isCompressionSupported(Compression format);
+
+class DecompressionSource;
+
+// Read-only stream buffer returning decompressed contents of a file.
+// All entries of a zip archive are returned one after another, as
+// "unzip -p" does. Decompression stops at the first damaged byte.
+// Uncompressed data of files, pipes and open descriptors may be read
+// through it as well, to get it read ahead on a separate thread.
+class DecompressingBuf : public std::streambuf {
+	class Prefetcher;
+
+	DecompressionSource*	source;
+	Prefetcher*	prefetcher;
+	std::vector<char>	buffer;
+
+	DecompressingBuf(const DecompressingBuf&);
+	DecompressingBuf& operator=(const DecompressingBuf&);
+
+	bool start(bool background);
+
+public:
+	enum {BlockSize = 1024 * 1024};
+
+	DecompressingBuf();
+	virtual ~DecompressingBuf();
+
+	// returns false if file cannot be opened or format is not supported
+	// <background> means decompression runs on a separate thread ahead of
+	// the reader, so decompression and parsing overlap
+	bool open(const char* filename, Compression format, bool background = false);
+	// uncompressed data of open <descriptor>, e.g. 0 for standard input;
+	// descriptor is not closed
+	bool open(int descriptor, bool background = false);
+	void close();
+
+	inline bool isOpen() const {
+		return 0 != source;
+	}
+
+	// compressed data is damaged or truncated, format is not supported
+	// or data cannot be read
+	bool failed() const;
+
+protected:
+	virtual int_type underflow();
+};
+
+class CompressionSink;
+
+// Write-only stream buffer compressing data into a gzip or zstd file.
+// Appended data is written as a new gzip member or zstd frame, which
+// readers take as continuation of the previous data. Data is compressed
+// by blocks; flushing the stream does not force compression, so the file
+// is complete only after close().
+class CompressingBuf : public std::streambuf {
+	class Compressor;
+
+	CompressionSink*	sink;
+	Compressor*	compressor;
+	std::vector<char>	buffer;
+	bool	error;
+
+	bool writeBlock();
+
+	CompressingBuf(const CompressingBuf&);
+	CompressingBuf& operator=(const CompressingBuf&);
+
+public:
+	enum {BlockSize = 1024 * 1024};
+
+	CompressingBuf();
+	virtual ~CompressingBuf();	// closes file
+
+	// Returns false if file cannot be opened or format is not supported.
+	// <level> is compression level of the format, 0 means default one.
+	// <background> means compression runs on a separate thread while the
+	// writer fills next blocks.
+	bool open(const char* filename, Compression format, int level = 0,
+			bool append = false, bool background = false);
+	// returns false if data cannot be written
+	bool close();
+
+	inline bool isOpen() const {
+		return 0 != sink;
+	}
+
+	bool failed() const;
+
+protected:
+	virtual int_type overflow(int_type c);
+};
+
+}
+
+#endif	//	__MD_COMPRESSION_H_918273645501928374655019
@@ -0,0 +1,259 @@
+/*
+ * densematrix.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdlib.h>
+#include	<string.h>
+#include	<new>
+#include	<algorithm>
+#ifdef	_MSC_VER
+#include	<malloc.h>
+#endif
+#include	"densematrix.h"
+#include	"vectorkernels.h"
+
+namespace phlib {
+
+static double* allocateAligned(size_t count)
+{
+	if (0 == count)
+		return 0;
+
+	void*	p;
+#ifdef	_MSC_VER
+	if (0 == (p = _aligned_malloc(count * sizeof(double), dense_matrix::Alignment)))
+		throw std::bad_alloc();
+#else	//	_MSC_VER
+	if (0 != ::posix_memalign(&p, dense_matrix::Alignment, count * sizeof(double)))
+		throw std::bad_alloc();
+#endif	//	_MSC_VER
+	return static_cast<double*>(p);
+}
+
+static void freeAligned(double* p)
+{
+#ifdef	_MSC_VER
+	_aligned_free(p);
+#else	//	_MSC_VER
+	::free(p);
+#endif	//	_MSC_VER
+}
+
+dense_matrix::dense_matrix(size_type rows, size_type cols, bool aligned)
+	: buffer(0), rowCount(0), columnCount(0), rowStride(0), rowCapacity(0), aligned(aligned)
+{
+	relocate(rows, cols);
+	rowCount = rows;
+}
+
+dense_matrix::dense_matrix(const dense_matrix& m)
+	: buffer(0), rowCount(0), columnCount(0), rowStride(0), rowCapacity(0), aligned(m.aligned)
+{
+	*this = m;
+}
+
+dense_matrix::dense_matrix(const float_matrix& m, bool aligned)
+	: buffer(0), rowCount(0), columnCount(0), rowStride(0), rowCapacity(0), aligned(aligned)
+{
+	*this = m;
+}
+
+dense_matrix::~dense_matrix()
+{
+	freeAligned(buffer);
+}
+
+dense_matrix& dense_matrix::operator=(const dense_matrix& m)
+{
+	if (this == &m)
+		return *this;
+
+	if (rowCapacity < m.rowCount || strideFor(m.columnCount) != rowStride)
+		relocate(m.rowCount, m.columnCount);
+	columnCount = m.columnCount;
+	rowCount = m.rowCount;
+
+	if (rowStride == m.rowStride)
+		::memcpy(buffer, m.buffer, rowCount * rowStride * sizeof(element_type));
+	else
+		for (size_type i = 0; i < rowCount; i++)
+			::memcpy(buffer + i * rowStride, m.buffer + i * m.rowStride, columnCount * sizeof(element_type));
+
+	return *this;
+}
+
+dense_matrix& dense_matrix::operator=(const float_matrix& m)
+{
+	size_type	cols = 0;
+	for (float_matrix::const_iterator i = m.begin(); i != m.end(); i++)
+		cols = std::max(cols, i->size());
+
+	if (rowCapacity < m.size() || strideFor(cols) != rowStride)
+		relocate(m.size(), cols);
+	columnCount = cols;
+	rowCount = m.size();
+
+	for (size_type i = 0; i < rowCount; i++)
+		(*this)[i] = m[i];
+
+	return *this;
+}
+
+void dense_matrix::swap(dense_matrix& m)
+{
+	std::swap(buffer, m.buffer);
+	std::swap(rowCount, m.rowCount);
+	std::swap(columnCount, m.columnCount);
+	std::swap(rowStride, m.rowStride);
+	std::swap(rowCapacity, m.rowCapacity);
+	std::swap(aligned, m.aligned);
+}
+
+void dense_matrix::rows(size_type r)
+{
+	if (r > rowCapacity)
+		relocate(std::max(r, rowCapacity * 2), columnCount);
+
+	if (r > rowCount)
+		::memset(buffer + rowCount * rowStride, 0, (r - rowCount) * rowStride * sizeof(element_type));
+	rowCount = r;
+}
+
+void dense_matrix::columns(size_type cols)
+{
+	if (strideFor(cols) != rowStride)
+		relocate(rowCapacity, cols);
+	else if (cols > columnCount)
+		for (size_type i = 0; i < rowCount; i++)
+			std::fill(buffer + i * rowStride + columnCount, buffer + i * rowStride + cols, 0.0);
+	columnCount = cols;
+}
+
+void dense_matrix::reserve(size_type rows)
+{
+	if (rows > rowCapacity)
+		relocate(rows, columnCount);
+}
+
+void dense_matrix::add(const float_vector& v)
+{
+	if (v.size() > columnCount)
+		columns(v.size());
+	rows(rowCount + 1);
+	(*this)[rowCount - 1] = v;
+}
+
+void dense_matrix::setColumn(size_type column_index, const float_vector& column)
+{
+	if (rows() == column.size()) {
+		for (size_type i = 0; i < column.size(); i++)
+			at(i, column_index) = column[i];
+	}
+}
+
+dense_matrix::element_type dense_matrix::getMax() const
+{
+	if (empty() || 0 == columnCount)
+		return 0.0;
+
+	const VectorKernels& k = vectorKernels();
+	if (rowStride == columnCount)
+		return k.max(buffer, rowCount * columnCount);
+
+	element_type res = k.max(buffer, columnCount), f;
+	for (size_type i = 1; i < rowCount; i++) {
+		f = k.max(buffer + i * rowStride, columnCount);
+		if (res < f)
+			res = f;
+	}
+	return res;
+}
+
+dense_matrix::element_type dense_matrix::getMin() const
+{
+	if (empty() || 0 == columnCount)
+		return 0.0;
+
+	const VectorKernels& k = vectorKernels();
+	if (rowStride == columnCount)
+		return k.min(buffer, rowCount * columnCount);
+
+	element_type res = k.min(buffer, columnCount), f;
+	for (size_type i = 1; i < rowCount; i++) {
+		f = k.min(buffer + i * rowStride, columnCount);
+		if (res > f)
+			res = f;
+	}
+	return res;
+}
+
+void dense_matrix::setLowerBound(const element_type f)
+{
+	for (size_type i = 0; i < rowCount; i++)
+		(*this)[i] = lowerBound((*this)[i], f);
+}
+
+void dense_matrix::setUpperBound(const element_type f)
+{
+	for (size_type i = 0; i < rowCount; i++)
+		(*this)[i] = upperBound((*this)[i], f);
+}
+
+void dense_matrix::normalize(element_type a0, element_type b0, element_type a1, element_type b1)
+{
+	element_type div = b0 - a0;
+	if (div == 0.0 || 0 == columnCount)
+		return;	// bad initial range
+
+	const VectorKernels& k = vectorKernels();
+	for (size_type i = 0; i < rowCount; i++)
+		k.linear(buffer + i * rowStride, columnCount, a0, (b1 - a1) / div, a1);
+}
+
+void dense_matrix::copyTo(float_matrix& m) const
+{
+	m.rows(rowCount);
+	for (size_type i = 0; i < rowCount; i++)
+		m[i] = (*this)[i];
+}
+
+dense_matrix::size_type dense_matrix::strideFor(size_type cols) const
+{
+	if (!aligned)
+		return cols;
+
+	const size_type	perLine = Alignment / sizeof(element_type);
+	return (cols + perLine - 1) / perLine * perLine;
+}
+
+// reallocate buffer for <capacity> rows of <cols> columns keeping the data
+void dense_matrix::relocate(size_type capacity, size_type cols)
+{
+	const size_type	stride = strideFor(cols);
+	element_type*	p = allocateAligned(capacity * stride);
+	const size_type	keepRows = std::min(rowCount, capacity), keepCols = std::min(columnCount, cols);
+
+	if (p) {
+		::memset(p, 0, capacity * stride * sizeof(element_type));
+		for (size_type i = 0; i < keepRows; i++)
+			::memcpy(p + i * stride, buffer + i * rowStride, keepCols * sizeof(element_type));
+	}
+
+	freeAligned(buffer);
+	buffer = p;
+	rowStride = stride;
+	rowCapacity = capacity;
+	columnCount = cols;
+	rowCount = keepRows;
+}
+
+}
@@ -0,0 +1,208 @@
+/*
+ * densematrix.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Matrix of doubles stored in one contiguous row-major block.
+ * Unlike float_matrix, rows are not separate heap objects: a row is a
+ * light-weight view into the block. Aligned matrices start at a 64-byte
+ * boundary and pad every row to a multiple of 64 bytes, so each row is
+ * itself aligned; packed (not aligned) matrices have no padding at all.
+ */
+
+#ifndef	__MD_DENSEMATRIX_H_918273645501928374659102837
+#define	__MD_DENSEMATRIX_H_918273645501928374659102837
+
+#include	<stddef.h>
+#include	"floatvector.h"
+#include	"floatmatrix.h"
+
+namespace phlib {
+
+class dense_matrix {
+public:
+	typedef double	element_type;
+	typedef size_t	size_type;
+
+	enum {Alignment = 64};
+
+	// view of one matrix row, valid until the matrix is resized
+	template <class T>
+	class basic_row_view : public vector_expression<basic_row_view<T> > {
+		T*	first;
+		size_type	n;
+
+	public:
+		typedef T*	iterator;
+
+		inline basic_row_view(T* first, size_type n) : first(first), n(n) {}
+
+		inline size_type size() const {
+			return n;
+		}
+		inline T* begin() const {
+			return first;
+		}
+		inline T* end() const {
+			return first + n;
+		}
+		inline T& operator[](size_type i) const {
+			return first[i];
+		}
+
+		// vector_expression interface
+		inline bool dense(size_t sz) const {
+			return n >= sz;
+		}
+		inline element_type at(size_t i) const {
+			return i < n ? first[i] : 0.0;
+		}
+
+		// copy of row data
+		inline float_vector vector() const {
+			return float_vector(*this);
+		}
+
+		// copy vector into the row, missing elements are set to zero
+		basic_row_view& operator=(const float_vector& v) {
+			for (size_type i = 0; i < n; i++)
+				first[i] = i < v.size() ? v[i] : 0.0;
+			return *this;
+		}
+
+		// evaluate expression directly into the row
+		template <class E>
+		basic_row_view& operator=(const vector_expression<E>& e) {
+			evaluate(first, n, e);
+			return *this;
+		}
+
+		// view assignment copies data, not the view
+		basic_row_view& operator=(const basic_row_view& v) {
+			if (v.first != first)
+				evaluate(first, n, v);
+			return *this;
+		}
+	};
+
+	typedef basic_row_view<element_type>	row_view;
+	typedef basic_row_view<const element_type>	const_row_view;
+
+	inline dense_matrix() : buffer(0), rowCount(0), columnCount(0), rowStride(0), rowCapacity(0), aligned(true) {}
+	dense_matrix(size_type rows, size_type cols, bool aligned = true);
+	dense_matrix(const dense_matrix&);
+	explicit dense_matrix(const float_matrix&, bool aligned = true);
+	~dense_matrix();
+
+	dense_matrix& operator=(const dense_matrix&);
+	dense_matrix& operator=(const float_matrix&);
+	void swap(dense_matrix&);
+
+	inline size_type rows() const {
+		return rowCount;
+	}
+	void rows(size_type r);
+	inline size_type columns() const {
+		return columnCount;
+	}
+	void columns(size_type cols);
+	void reserve(size_type rows);
+
+	// distance between starts of adjacent rows, in elements
+	inline size_type stride() const {
+		return rowStride;
+	}
+	inline bool isAligned() const {
+		return aligned;
+	}
+	inline bool empty() const {
+		return 0 == rowCount;
+	}
+
+	inline element_type* data() {
+		return buffer;
+	}
+	inline const element_type* data() const {
+		return buffer;
+	}
+
+	inline row_view operator[](size_type row) {
+		return row_view(buffer + row * rowStride, columnCount);
+	}
+	inline const_row_view operator[](size_type row) const {
+		return const_row_view(buffer + row * rowStride, columnCount);
+	}
+
+	inline element_type& at(size_type row, size_type col) {
+		return buffer[row * rowStride + col];
+	}
+	inline const element_type& at(size_type row, size_type col) const {
+		return buffer[row * rowStride + col];
+	}
+
+	// append row; matrix gets wider if the row is longer than others
+	void add(const float_vector& v);
+
+	void setColumn(size_type column_index, const float_vector& column);
+
+	element_type getMax() const;
+	element_type getMin() const;
+
+	void setLowerBound(const element_type);
+	void setUpperBound(const element_type);
+
+	void normalize(element_type a0, element_type b0, element_type a1, element_type b1);
+
+	void copyTo(float_matrix&) const;
+
+private:
+	element_type*	buffer;
+	size_type	rowCount, columnCount, rowStride, rowCapacity;
+	bool	aligned;
+
+	size_type strideFor(size_type cols) const;
+	void relocate(size_type capacity, size_type cols);
+};
+
+class dense_matrix_stream {
+	dense_matrix& matrix;
+	dense_matrix::size_type current_row, current_column;
+
+public:
+	dense_matrix_stream(dense_matrix& m) : matrix(m) {
+		reset();
+	}
+
+	inline void reset() {
+		current_row = current_column = 0;
+	}
+
+	dense_matrix_stream& operator<<(dense_matrix::element_type x)
+	{
+		if (current_row >= matrix.rows() || 0 == matrix.columns())
+			return *this;
+
+		if (current_column == matrix.columns()) {
+			if (++current_row == matrix.rows())
+				return *this;
+			current_column = 0;
+		}
+
+		matrix.at(current_row, current_column++) = x;
+
+		return *this;
+	}
+};
+
+}
+
+#endif	//	__MD_DENSEMATRIX_H_918273645501928374659102837
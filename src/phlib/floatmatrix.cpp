@@ -13,6 +13,8 @@
 
 #include <math.h>
 #include "floatmatrix.h"
+#include "densematrix.h"
+#include "ludecomposition.h"
 
 namespace phlib {
 
@@ -102,7 +104,18 @@ float_matrix::element_type float_matrix::getMin() const
 	return res;
 }
 
-float_matrix::element_type float_matrix::D() const
+// determinant of matrix which is damaged after calculation
+static float_matrix::element_type calcDenseD(dense_matrix& m, unsigned threads)
+{
+	permutation_vector	perm;
+	int	parity;
+
+	if (!luDecompose(m, perm, parity, threads))
+		return 0.0f;	//	matrix is singular
+	return luDeterminant(m, perm, parity);
+}
+
+float_matrix::element_type float_matrix::D(unsigned threads) const
 {
 	if (rows() != columns() || !rows())
 		return 0.0f;
@@ -111,18 +124,18 @@ float_matrix::element_type float_matrix::D() const
 	else if (2 == rows())
 		return at(0, 0) * at(1, 1) - at(0, 1) * at(1, 0);
 	else {
-		float_matrix	temp(*this);
-		return temp.calcD();
+		dense_matrix	temp(*this);
+		return calcDenseD(temp, threads);
 	}
 }
 
-float_matrix::element_type float_matrix::D(int column_index, const float_vector& column) const
+float_matrix::element_type float_matrix::D(int column_index, const float_vector& column, unsigned threads) const
 {
 	if (rows() != columns() || !rows() || rows() != column.size())
 		return 0.0f;
-	float_matrix temp(*this);
+	dense_matrix temp(*this);
 	temp.setColumn(column_index, column);
-	return temp.calcD();
+	return calcDenseD(temp, threads);
 }
 
 void float_matrix::setLowerBound(const element_type f)
@@ -151,87 +164,30 @@ void float_matrix::interchangeRows(int row1, int row2)
 		std::swap(at(row1, i), at(row2, i));
 }
 
-bool float_matrix::decompose(double& d)
+// on success matrix holds L and U packed together, rows are interchanged
+bool float_matrix::decompose(double& d, unsigned threads)
 {
-	size_type	i, j, k, imax = 0;
-	double	sum, aamax, dum;
-	float_vector	v(rows());
-	std::vector<size_type>	indx(rows(), 0);
+	dense_matrix	lu(*this);
+	permutation_vector	perm;
+	int	parity;
 
 	d = 1.0f;
+	if (!luDecompose(lu, perm, parity, threads))
+		return false;
 
-	// loop over rows to get the implicit scalling information
-	for (i = 0; i < rows(); i++) {
-		aamax = 0.0f;
-
-		for (j = 0; j < columns(); j++) {
-			if (::fabs(at(i, j)) > aamax)
-				aamax = at(i, j);
-		}
-
-		if (aamax == 0.0)
-			return false;	//	singular matrix
-							//	no nonzero largest element
-
-		v[i] = 1.0f / aamax;	//	save the scaling
-	}
-
-	for (j = 0; j < columns(); j++) {	//	this is the loop over columns of Crout's method
-		for (i = 0; i < j; i++) {	//	this is equation 2.3.12 except for "i = j"
-			sum = at(i, j);
-
-			for (k = 0; k < i; k++)
-				sum -= at(i, k) * at(k, j);
-
-			at(i, j) = sum;
-		}
-
-		aamax = 0.0;	//	initialize for the search for largest pivot element
-
-		for (i = j; i < rows(); i++) {	//	this is "i = j" of equation 2.3.12
-										//	and "i = j + 1 ... N" of equation 2.3.13
-			sum = at(i, j);
-
-			for (k = 0; k < j; k++)
-				sum -= at(i, k) * at(k, j);
-
-			at(i, j) = sum;
-
-			dum = v[i] * ::fabs(sum);	//	figure of merit for the pivot
-			if (dum >= aamax) {	//	is it better than the best so far?
-				imax = i;
-				aamax = dum;
-			}
-		}
-
-		if (j != imax) {	//	do we need to interchange rows?
-			interchangeRows(j, imax);	//	yes, do so...
-			d = -d;	//	and change the parity of D
-			v[imax] = v[j];	//	also interchange the scale factor
-		}
-
-		indx[j] = imax;
-
-		if (0.0 == at(j, j))
-			return false;	// matrix is singular
-
-		if (j != columns() - 1) {	//	now, finally divide by the pivot element
-			dum = 1.0f / at(j, j);	//	if the pivot element is zero the matrix is singular
-									//	at least to the precision of the algorithm).
-			for (i = j + 1; i < rows(); i++)
-				at(i, j) *= dum;
-		}
-	}	//	go back to the next column in the reduction
+	for (size_type i = 0; i < rows(); i++)
+		(*this)[i] = lu[perm[i]];
+	d = parity;
 
 	return true;
 }
 
 // matrix is damaged after calculation
-float_matrix::element_type float_matrix::calcD()
+float_matrix::element_type float_matrix::calcD(unsigned threads)
 {
 	element_type	summ;
 
-	if (decompose(summ)) {
+	if (decompose(summ, threads)) {
 		for (register float_matrix::size_type i = 0; i < rows(); i++)
 			summ *= at(i, i);
 	}
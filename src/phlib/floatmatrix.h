@@ -56,8 +56,10 @@ public:
 	element_type getMax() const;
 	element_type getMin() const;
 
-	element_type D() const;
-	element_type D(int column_index, const float_vector& column) const;
+	// threads > 1 enables parallel decomposition of large matrices
+	element_type D(unsigned threads = 1) const;
+	// factorizes matrix on every call, see lu_factorization for repeated substitutions
+	element_type D(int column_index, const float_vector& column, unsigned threads = 1) const;
 
 	void setLowerBound(const element_type);
 	void setUpperBound(const element_type);
@@ -66,8 +68,8 @@ public:
 	void interchangeRows(int row1, int row2);
 
 protected:
-	bool decompose(double& d);
-	element_type calcD();
+	bool decompose(double& d, unsigned threads = 1);
+	element_type calcD(unsigned threads = 1);
 };
 
 class float_matrix_stream {
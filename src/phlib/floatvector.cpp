@@ -15,6 +15,7 @@
 #include	<iterator>
 #include	<math.h>
 #include	"floatvector.h"
+#include	"vectorkernels.h"
 
 namespace phlib {
 
@@ -36,42 +37,32 @@ float_vector& float_vector::operator=(const float_vector& src)
 
 float_vector& float_vector::operator+=(const float_vector& v)
 {
-	register iterator i;
-	register const_iterator v_i;
-	register const_iterator v_last;
+	if (v.empty())
+		return *this;
 
 	if (size() < v.size())
 		resize(v.size(), 0.0);
 
-	for (i = begin(), v_i = v.begin(), v_last = v.end(); v_i < v_last; )
-		*i++ += *v_i++;
-
+	vectorKernels().add(&(*begin()), &(*v.begin()), v.size());
 	return *this;
 }
 
 float_vector& float_vector::operator-=(const float_vector& v)
 {
-	register iterator i;
-	register const_iterator v_i;
-	register const_iterator v_last;
+	if (v.empty())
+		return *this;
 
 	if (size() < v.size())
 		resize(v.size(), 0.0);
 
-	for (i = begin(), v_i = v.begin(), v_last = v.end(); v_i < v_last; )
-		*i++ -= *v_i++;
-
+	vectorKernels().sub(&(*begin()), &(*v.begin()), v.size());
 	return *this;
 }
 
 float_vector& float_vector::operator*=(element_type v)
 {
-	register iterator i;
-	register const_iterator last;
-
-	for (i = begin(), last = end(); i < last; )
-		*i++ *= v;
-
+	if (!empty())
+		vectorKernels().scale(&(*begin()), size(), v);
 	return *this;
 }
 
@@ -84,22 +75,19 @@ float_vector& float_vector::operator/=(element_type v)
 
 void float_vector::addMul(const float_vector& v, element_type mult)
 {
-	register iterator i;
-	register const_iterator v_i;
-	register const_iterator v_last;
+	if (v.empty())
+		return;
 
 	if (size() < v.size())
 		resize(v.size(), 0.0);
 
-	for (i = begin(), v_i = v.begin(), v_last = v.end(); v_i < v_last; )
-		*i++ += *v_i++ * mult;
+	vectorKernels().addMul(&(*begin()), &(*v.begin()), v.size(), mult);
 }
 
 void float_vector::subDiv(const float_vector& v, element_type divisor)
 {
-	register iterator i;
-	register const_iterator v_i;
-	register const_iterator v_last;
+	if (v.empty())
+		return;
 
 	if (size() < v.size())
 		resize(v.size(), 0.0);
@@ -107,59 +95,33 @@ void float_vector::subDiv(const float_vector& v, element_type divisor)
 	if (divisor == 0.0)
 		divisor = 1.0;
 
-	for (i = begin(), v_i = v.begin(), v_last = v.end(); v_i < v_last; ) {
-		*i -= *v_i++;
-		*i++ /= divisor;
-	}
+	vectorKernels().subDiv(&(*begin()), &(*v.begin()), v.size(), divisor);
 }
 
 void float_vector::addSquared(const float_vector& v)
 {
-	register iterator i;
-	register const_iterator v_i;
-	register const_iterator v_last;
+	if (v.empty())
+		return;
 
 	if (size() < v.size())
 		resize(v.size(), 0.0);
 
-	for (i = begin(), v_i = v.begin(), v_last = v.end(); v_i < v_last; ) {
-		const double v = *v_i++;
-		*i++ += v * v;
-	}
+	vectorKernels().addSquared(&(*begin()), &(*v.begin()), v.size());
 }
 
 float_vector::element_type float_vector::getSumm() const
 {
-	element_type res = 0.0;
-
-	for (register const_iterator i = begin(); i != end(); i++)
-		res += *i;
-
-	return res;
+	return empty() ? 0.0 : vectorKernels().summ(&(*begin()), size());
 }
 
 float_vector::element_type float_vector::getMax() const
 {
-	register const_iterator src;
-	element_type res = size() ? front() : 0.0;
-
-	for (src = begin() + 1; src != end(); src++)
-		if (res < *src)
-			res = *src;
-
-	return res;
+	return empty() ? 0.0 : vectorKernels().max(&(*begin()), size());
 }
 
 float_vector::element_type float_vector::getMin() const
 {
-	register const_iterator src;
-	element_type res = size() ? front() : 0.0;
-
-	for (src = begin() + 1; src != end(); src++)
-		if (res > *src)
-			res = *src;
-
-	return res;
+	return empty() ? 0.0 : vectorKernels().min(&(*begin()), size());
 }
 
 void float_vector::setMin(const float_vector& v)
@@ -240,11 +202,8 @@ void float_vector::normalize(element_type a0, element_type b0, element_type a1,
 	if (div == 0.0)
 		return;	// bad initial range
 
-	element_type mul = (b1 - a1) / div;
-	register iterator src;
-
-	for (src = begin(); src != end(); src++)
-		*src = (*src - a0) * mul + a1;
+	if (!empty())
+		vectorKernels().linear(&(*begin()), size(), a0, (b1 - a1) / div, a1);
 }
 
 bool float_vector::isZero() const
@@ -16,6 +16,7 @@
 
 #include	<vector>
 #include	<iostream>
+#include	"vectorexpr.hpp"
 
 namespace phlib {
 
@@ -24,14 +25,21 @@ public:
 	typedef value_type	element_type;
 
 	inline float_vector() {}
-	inline float_vector(size_type n) : std::vector<double>(n) {}
+	inline explicit float_vector(size_type n) : std::vector<double>(n) {}
 	inline float_vector(size_type n, const value_type& t) : std::vector<double>(n, t) {}
 	inline float_vector(const float_vector& v) {
 		*this = v;
 	}
 	float_vector(const float_vector& v, size_type excluded_index);
+	template <class E>
+	inline float_vector(const vector_expression<E>& e) : std::vector<double>(e.self().size()) {
+		if (!empty())
+			evaluate(&(*begin()), size(), e);
+	}
 
 	float_vector& operator=(const float_vector&);
+	template <class E>
+	float_vector& operator=(const vector_expression<E>&);
 	float_vector& operator+=(const float_vector&);
 	float_vector& operator-=(const float_vector&);
 	float_vector& operator*=(element_type v);
@@ -84,6 +92,28 @@ public:
 
 std::ostream& operator<<(std::ostream&, const float_vector&);
 
+inline vector_terminal make_operand(const float_vector& v)
+{
+	return vector_terminal(v);
+}
+
+// expression may refer to this vector, so it is evaluated in place
+// when sizes match and into a temporary otherwise
+template <class E>
+float_vector& float_vector::operator=(const vector_expression<E>& e)
+{
+	const size_type sz = e.self().size();
+	if (sz == size()) {
+		if (sz)
+			evaluate(&(*begin()), sz, e);
+	}
+	else {
+		float_vector temp(e);
+		swap(temp);
+	}
+	return *this;
+}
+
 }
 
 #endif	//	__MD_FLOATVECTOR_H_895897358634785645126457657
@@ -0,0 +1,341 @@
+/*
+ * ludecomposition.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<math.h>
+#include	<algorithm>
+#include	<memory>
+#include	"ludecomposition.h"
+#include	"vectorkernels.h"
+#include	"thread.h"
+
+namespace phlib {
+
+typedef dense_matrix::size_type	size_type;
+typedef dense_matrix::element_type	element_type;
+
+enum {
+	BlockSize = 64,	// panel width
+	TileColumns = 256,	// columns of U12 kept in cache during trailing update
+	ParallelRows = 128	// minimal number of trailing rows per thread
+};
+
+// A22 -= L21 * U12 for logical rows [rowBegin, rowEnd)
+static void updateTrailing(element_type* const* rows, size_type k0, size_type k1, size_type n,
+		size_type rowBegin, size_type rowEnd)
+{
+	const VectorKernels&	k = vectorKernels();
+
+	for (size_type cb = k1; cb < n; cb += TileColumns) {
+		const size_type	ce = std::min<size_type>(cb + TileColumns, n);
+		for (size_type i = rowBegin; i < rowEnd; i++) {
+			element_type*	ri = rows[i];
+			for (size_type p = k0; p < k1; p++)
+				if (0.0 != ri[p])
+					k.addMul(ri + cb, rows[p] + cb, ce - cb, -ri[p]);
+		}
+	}
+}
+
+class TrailingUpdate : public Runnable {
+	element_type* const*	rows;
+	size_type	k0, k1, n, rowBegin, rowEnd;
+
+public:
+	TrailingUpdate(element_type* const* rows, size_type k0, size_type k1, size_type n,
+			size_type rowBegin, size_type rowEnd) :
+		rows(rows), k0(k0), k1(k1), n(n), rowBegin(rowBegin), rowEnd(rowEnd) {}
+
+	virtual void run() {
+		updateTrailing(rows, k0, k1, n, rowBegin, rowEnd);
+	}
+};
+
+bool luDecompose(dense_matrix& a, permutation_vector& perm, int& parity, unsigned threads)
+{
+	const size_type	n = a.rows();
+	if (n != a.columns() || 0 == n)
+		return false;
+
+	const VectorKernels&	k = vectorKernels();
+	std::vector<element_type*>	rows(n);
+	float_vector	scale(n);
+
+	perm.resize(n);
+	parity = 1;
+
+	// loop over rows to get the implicit scaling information
+	for (size_type i = 0; i < n; i++) {
+		perm[i] = i;
+		rows[i] = &a.at(i, 0);
+
+		element_type	aamax = 0.0;
+		for (size_type j = 0; j < n; j++)
+			aamax = std::max(aamax, ::fabs(rows[i][j]));
+
+		if (0.0 == aamax)
+			return false;	// singular matrix, no nonzero largest element
+
+		scale[i] = 1.0 / aamax;
+	}
+
+	std::auto_ptr<ThreadPool>	pool;
+	if (threads > 1 && n >= 2 * ParallelRows) {
+		pool.reset(new ThreadPool(threads));
+		// there are no worker threads with MSVC, see thread.h
+		if (0 == pool->size())
+			pool.reset();
+	}
+
+	for (size_type k0 = 0; k0 < n; k0 += BlockSize) {
+		const size_type	k1 = std::min<size_type>(k0 + BlockSize, n);
+
+		// factorize panel of columns [k0, k1)
+		for (size_type j = k0; j < k1; j++) {
+			size_type	imax = j;
+			element_type	big = -1.0;
+
+			for (size_type i = j; i < n; i++) {
+				const element_type	dum = scale[i] * ::fabs(rows[i][j]);	// figure of merit for the pivot
+				if (dum > big) {
+					imax = i;
+					big = dum;
+				}
+			}
+
+			if (j != imax) {
+				std::swap(rows[j], rows[imax]);
+				std::swap(scale[j], scale[imax]);
+				std::swap(perm[j], perm[imax]);
+				parity = -parity;
+			}
+
+			if (0.0 == rows[j][j])
+				return false;	// matrix is singular
+
+			const element_type	dum = 1.0 / rows[j][j];
+			for (size_type i = j + 1; i < n; i++) {
+				element_type*	ri = rows[i];
+				ri[j] *= dum;
+				if (j + 1 < k1 && 0.0 != ri[j])
+					k.addMul(ri + j + 1, rows[j] + j + 1, k1 - j - 1, -ri[j]);
+			}
+		}
+
+		if (k1 == n)
+			break;
+
+		// U12 = inverse(L11) * A12
+		for (size_type i = k0 + 1; i < k1; i++)
+			for (size_type p = k0; p < i; p++)
+				if (0.0 != rows[i][p])
+					k.addMul(rows[i] + k1, rows[p] + k1, n - k1, -rows[i][p]);
+
+		// A22 -= L21 * U12
+		const size_type	trailing = n - k1;
+		if (pool.get() && trailing >= 2 * ParallelRows) {
+			const size_type	parts = std::min<size_type>(pool->size(), trailing / ParallelRows);
+			std::vector<TrailingUpdate>	tasks;
+			tasks.reserve(parts);
+			for (size_type t = 0; t < parts; t++)
+				tasks.push_back(TrailingUpdate(&rows[0], k0, k1, n,
+						k1 + trailing * t / parts, k1 + trailing * (t + 1) / parts));
+			for (size_type t = 0; t < parts; t++)
+				pool->submit(tasks[t]);
+			pool->wait();
+		}
+		else
+			updateTrailing(&rows[0], k0, k1, n, k1, n);
+	}
+
+	return true;
+}
+
+element_type luDeterminant(const dense_matrix& lu, const permutation_vector& perm, int parity)
+{
+	element_type	d = parity;
+	for (size_type i = 0; i < perm.size(); i++)
+		d *= lu.at(perm[i], i);
+	return d;
+}
+
+///////////////////////////////////////////
+//
+// lu_factorization members
+//
+///////////////////////////////////////////
+
+lu_factorization::lu_factorization(const float_matrix& m, unsigned threads) :
+	parity(1), singular(true), det(0.0), threads(threads)
+{
+	factorize(m);
+}
+
+lu_factorization::lu_factorization(const dense_matrix& m, unsigned threads) :
+	parity(1), singular(true), det(0.0), threads(threads)
+{
+	factorize(m);
+}
+
+bool lu_factorization::factorize(const float_matrix& m)
+{
+	current = m;
+	return refactorize();
+}
+
+bool lu_factorization::factorize(const dense_matrix& m)
+{
+	current = m;
+	return refactorize();
+}
+
+bool lu_factorization::refactorize()
+{
+	ws.clear();
+	vs.clear();
+	sigmas.clear();
+
+	lu = current;
+	singular = !luDecompose(lu, perm, parity, threads);
+	det = singular ? 0.0 : luDeterminant(lu, perm, parity);
+	return !singular;
+}
+
+// x = inverse(A0) * x
+void lu_factorization::solveFactors(float_vector& x) const
+{
+	const size_type	n = size();
+	float_vector	y(n);
+
+	for (size_type i = 0; i < n; i++) {
+		const element_type*	r = &lu.at(perm[i], 0);
+		element_type	sum = x[perm[i]];
+		for (size_type p = 0; p < i; p++)
+			sum -= r[p] * y[p];
+		y[i] = sum;
+	}
+
+	for (size_type i = n; i-- > 0; ) {
+		const element_type*	r = &lu.at(perm[i], 0);
+		element_type	sum = y[i];
+		for (size_type p = i + 1; p < n; p++)
+			sum -= r[p] * y[p];
+		y[i] = sum / r[i];
+	}
+
+	x.swap(y);
+}
+
+bool lu_factorization::solve(const float_vector& b, float_vector& x) const
+{
+	if (singular || b.size() != size())
+		return false;
+
+	x = b;
+	solveFactors(x);
+
+	// inverse(I + w * v') = I - w * v' / (1 + v' * w)
+	for (size_type k = 0; k < ws.size(); k++) {
+		const float_vector&	v = vs[k];
+		element_type	dot = 0.0;
+		for (size_type i = 0; i < v.size(); i++)
+			dot += v[i] * x[i];
+		x.addMul(ws[k], -dot / sigmas[k]);
+	}
+
+	return true;
+}
+
+lu_factorization::element_type lu_factorization::determinant(size_type column_index, const float_vector& column) const
+{
+	if (column_index >= size() || column.size() != size())
+		return 0.0;
+
+	float_vector	x;
+	if (solve(column, x))
+		return det * x[column_index];
+
+	// singular matrix may become regular after substitution
+	dense_matrix	temp(current);
+	permutation_vector	p;
+	int	par;
+	temp.setColumn(column_index, column);
+	return luDecompose(temp, p, par, threads) ? luDeterminant(temp, p, par) : 0.0;
+}
+
+bool lu_factorization::determinants(const float_vector& column, float_vector& result) const
+{
+	if (!solve(column, result))
+		return false;
+	result *= det;
+	return true;
+}
+
+bool lu_factorization::update(const float_vector& u, const float_vector& v)
+{
+	const size_type	n = size();
+	if (u.size() != n || v.size() != n)
+		return false;
+
+	for (size_type i = 0; i < n; i++)
+		if (0.0 != u[i])
+			current[i] = current[i] + u[i] * v;
+
+	float_vector	w;
+	if (!solve(u, w))
+		return refactorize();
+
+	element_type	sigma = 1.0;
+	for (size_type i = 0; i < n; i++)
+		sigma += v[i] * w[i];
+
+	applyUpdate(w, v, sigma);
+	return !singular;
+}
+
+bool lu_factorization::replaceColumn(size_type column_index, const float_vector& column)
+{
+	const size_type	n = size();
+	if (column_index >= n || column.size() != n)
+		return false;
+
+	// column of inverse(A) * column replaces unit vector in the product
+	float_vector	w;
+	const bool	solved = solve(column, w);
+
+	current.setColumn(column_index, column);
+	if (!solved)
+		return refactorize();
+
+	const element_type	sigma = w[column_index];
+	w[column_index] -= 1.0;
+
+	float_vector	v(n, 0.0);
+	v[column_index] = 1.0;
+	applyUpdate(w, v, sigma);
+	return !singular;
+}
+
+void lu_factorization::applyUpdate(const float_vector& w, const float_vector& v, element_type sigma)
+{
+	if (0.0 == sigma || ws.size() >= MaxUpdates) {
+		refactorize();
+		return;
+	}
+
+	ws.push_back(w);
+	vs.push_back(v);
+	sigmas.push_back(sigma);
+	det *= sigma;
+}
+
+}
@@ -0,0 +1,105 @@
+/*
+ * ludecomposition.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_LUDECOMPOSITION_H_561029384756102938475610
+#define	__MD_LUDECOMPOSITION_H_561029384756102938475610
+
+#include	<vector>
+#include	"densematrix.h"
+
+namespace phlib {
+
+typedef std::vector<dense_matrix::size_type>	permutation_vector;
+
+// Blocked right-looking LU decomposition with partial pivoting.
+// Pivots are chosen with implicit row scaling, like Crout's method in
+// "Numerical Recipes", but rows are never moved: logical row i of the
+// factors is physical row perm[i] of <a>. On success <a> holds L (unit
+// diagonal, not stored) and U packed together. <parity> is -1 if the
+// number of row interchanges is odd and 1 otherwise.
+// Trailing updates of large matrices are spread over <threads> threads.
+// Returns false if matrix is singular or not square.
+bool luDecompose(dense_matrix& a, permutation_vector& perm, int& parity, unsigned threads = 1);
+
+// determinant of the matrix decomposed by luDecompose()
+dense_matrix::element_type luDeterminant(const dense_matrix& lu, const permutation_vector& perm, int parity);
+
+// Factorization of a square matrix which can be reused for many solutions
+// and determinants at O(n^2) each. Rank-1 updates and column replacements
+// are kept in product form, A = A0 * (I + w1 * v1') * ... , and the
+// matrix is factorized again after MaxUpdates of them.
+class lu_factorization {
+public:
+	typedef dense_matrix::element_type	element_type;
+	typedef dense_matrix::size_type	size_type;
+
+	enum {MaxUpdates = 32};
+
+	inline lu_factorization() : parity(1), singular(true), det(0.0), threads(1) {}
+	explicit lu_factorization(const float_matrix&, unsigned threads = 1);
+	explicit lu_factorization(const dense_matrix&, unsigned threads = 1);
+
+	// returns false if matrix is singular or not square
+	bool factorize(const float_matrix&);
+	bool factorize(const dense_matrix&);
+
+	inline size_type size() const {
+		return current.rows();
+	}
+	inline bool isSingular() const {
+		return singular;
+	}
+
+	inline element_type determinant() const {
+		return det;
+	}
+
+	// determinant of the matrix with column <column_index> replaced by <column>
+	element_type determinant(size_type column_index, const float_vector& column) const;
+
+	// determinants of the matrices with every column in turn replaced by <column>,
+	// i.e. numerators of the Cramer's rule
+	bool determinants(const float_vector& column, float_vector& result) const;
+
+	// solve A * x = b, returns false if matrix is singular
+	bool solve(const float_vector& b, float_vector& x) const;
+
+	// A += u * v'
+	bool update(const float_vector& u, const float_vector& v);
+
+	// set column <column_index> of A to <column>
+	bool replaceColumn(size_type column_index, const float_vector& column);
+
+	// matrix being factorized, with all the updates applied
+	inline const dense_matrix& matrix() const {
+		return current;
+	}
+
+private:
+	dense_matrix	lu, current;
+	permutation_vector	perm;
+	int	parity;
+	bool	singular;
+	element_type	det;
+	unsigned	threads;
+	std::vector<float_vector>	ws, vs;	// product form updates
+	float_vector	sigmas;	// 1 + v' * w for each update
+
+	bool refactorize();
+	void solveFactors(float_vector& x) const;
+	void applyUpdate(const float_vector& w, const float_vector& v, element_type sigma);
+};
+
+}
+
+#endif	//	__MD_LUDECOMPOSITION_H_561029384756102938475610
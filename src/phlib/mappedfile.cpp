@@ -0,0 +1,83 @@
+/*
+ * mappedfile.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	"mappedfile.h"
+#ifndef	_MSC_VER
+#include	<sys/types.h>
+#include	<sys/stat.h>
+#include	<sys/mman.h>
+#include	<fcntl.h>
+#include	<unistd.h>
+#endif
+
+namespace phlib {
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* filename, bool sequential)
+{
+	close();
+
+#ifdef	_MSC_VER
+	return false;
+#else	//	_MSC_VER
+	const int	fd = ::open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat	st;
+	if (0 != ::fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		::close(fd);
+		return false;
+	}
+
+	length = static_cast<size_t>(st.st_size);
+	if (length > 0) {
+		void*	p = ::mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == p) {
+			::close(fd);
+			length = 0;
+			return false;
+		}
+		address = static_cast<const char*>(p);
+
+		if (sequential)
+			::madvise(p, length, MADV_SEQUENTIAL);
+#ifdef	MADV_HUGEPAGE
+		// only a hint, kernels without huge page cache for files ignore it
+		::madvise(p, length, MADV_HUGEPAGE);
+#endif
+	}
+
+	// mapping stays valid after descriptor is closed
+	::close(fd);
+	opened = true;
+	return true;
+#endif	//	_MSC_VER
+}
+
+void MappedFile::close()
+{
+#ifndef	_MSC_VER
+	if (address)
+		::munmap(const_cast<char*>(address), length);
+#endif	//	_MSC_VER
+	address = 0;
+	length = 0;
+	opened = false;
+}
+
+}
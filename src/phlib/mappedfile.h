@@ -0,0 +1,53 @@
+/*
+ * mappedfile.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_MAPPEDFILE_H_657483920165748392016574
+#define	__MD_MAPPEDFILE_H_657483920165748392016574
+
+#include	<stddef.h>
+
+namespace phlib {
+
+// read-only memory mapping of a whole regular file
+class MappedFile {
+	const char*	address;
+	size_t	length;
+	bool	opened;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	inline MappedFile() : address(0), length(0), opened(false) {}
+	~MappedFile();
+
+	// returns false if file is not a regular file or cannot be mapped,
+	// e.g. pipes, terminals or platforms without mmap()
+	// <sequential> hints the kernel that file is read from start to end
+	bool open(const char* filename, bool sequential = true);
+	void close();
+
+	inline bool isOpen() const {
+		return opened;
+	}
+	inline const char* data() const {
+		return address;
+	}
+	inline size_t size() const {
+		return length;
+	}
+};
+
+}
+
+#endif	//	__MD_MAPPEDFILE_H_657483920165748392016574
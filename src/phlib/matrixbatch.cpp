@@ -0,0 +1,179 @@
+/*
+ * matrixbatch.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<math.h>
+#include	<string.h>
+#include	<algorithm>
+#include	<vector>
+#include	<memory>
+#include	"matrixbatch.h"
+#include	"vectorkernels.h"
+#include	"thread.h"
+
+#if	defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define	PHLIB_X86_KERNELS
+
+// results do not depend on instruction set and match float_matrix::D():
+// AVX-512 implies FMA, and contracting a * b + c into it changes rounding
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace phlib {
+
+enum {Lanes = 8};	// matrices processed side by side
+
+typedef size_t (*GroupProcessor)(const double* matrices, const double* rhs, size_t n, size_t count,
+		size_t firstGroup, size_t lastGroup, double* det, double* x);
+
+namespace generic_batch {
+#include	"matrixbatch.inc"
+}
+
+#ifdef	PHLIB_X86_KERNELS
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2_batch {
+#include	"matrixbatch.inc"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace avx512_batch {
+#include	"matrixbatch.inc"
+}
+#pragma GCC pop_options
+
+#endif	//	PHLIB_X86_KERNELS
+
+// follow the instruction set chosen for vector kernels
+static GroupProcessor selectProcessor()
+{
+#ifdef	PHLIB_X86_KERNELS
+	const char*	isa = vectorKernels().name;
+	if (0 == ::strcmp(isa, "avx512"))
+		return avx512_batch::processGroups;
+	if (0 == ::strcmp(isa, "avx2"))
+		return avx2_batch::processGroups;
+#endif	//	PHLIB_X86_KERNELS
+	return generic_batch::processGroups;
+}
+
+class BatchTask : public Runnable {
+	GroupProcessor	processor;
+	const double	*matrices, *rhs;
+	size_t	n, count, firstGroup, lastGroup;
+	double	*det, *x;
+
+public:
+	size_t	singular;
+
+	BatchTask(GroupProcessor processor, const double* matrices, const double* rhs, size_t n, size_t count,
+			size_t firstGroup, size_t lastGroup, double* det, double* x) :
+		processor(processor), matrices(matrices), rhs(rhs), n(n), count(count),
+		firstGroup(firstGroup), lastGroup(lastGroup), det(det), x(x), singular(0) {}
+
+	virtual void run() {
+		singular = processor(matrices, rhs, n, count, firstGroup, lastGroup, det, x);
+	}
+};
+
+static size_t processBatch(const double* matrices, const double* rhs, size_t n, size_t count,
+		double* det, double* x, unsigned threads)
+{
+	static const GroupProcessor	processor = selectProcessor();
+	const size_t	groups = (count + Lanes - 1) / Lanes;
+
+	if (threads <= 1 || groups < 2)
+		return processor(matrices, rhs, n, count, 0, groups, det, x);
+
+	const size_t	parts = std::min<size_t>(threads, groups);
+	std::vector<BatchTask>	tasks;
+	tasks.reserve(parts);
+	for (size_t t = 0; t < parts; t++)
+		tasks.push_back(BatchTask(processor, matrices, rhs, n, count,
+				groups * t / parts, groups * (t + 1) / parts, det, x));
+
+	// one pool serves all batches and grows to the largest number of threads
+	// requested, so frequent small batches do not start threads every time;
+	// parallel calls take turns, they would compete for the same cores
+	static Mutex	poolMutex;
+	static std::auto_ptr<ThreadPool>	pool;
+
+	ScopedLock	lock(poolMutex);
+	if (!pool.get() || pool->size() < parts)
+		pool.reset(new ThreadPool(static_cast<unsigned>(parts)));
+	for (size_t t = 0; t < parts; t++)
+		pool->submit(tasks[t]);
+	pool->wait();
+
+	size_t	singular = 0;
+	for (size_t t = 0; t < parts; t++)
+		singular += tasks[t].singular;
+	return singular;
+}
+
+///////////////////////////////////////////
+//
+// matrix_batch members
+//
+///////////////////////////////////////////
+
+bool matrix_batch::add(const float_matrix& m)
+{
+	if (m.rows() != n)
+		return false;
+	for (float_matrix::const_iterator i = m.begin(); i != m.end(); i++)
+		if (i->size() != n)
+			return false;
+
+	for (float_matrix::const_iterator i = m.begin(); i != m.end(); i++)
+		elements.insert(elements.end(), i->begin(), i->end());
+	return true;
+}
+
+bool matrix_batch::add(const dense_matrix& m)
+{
+	if (m.rows() != n || m.columns() != n)
+		return false;
+
+	for (size_type i = 0; i < n; i++)
+		elements.insert(elements.end(), m[i].begin(), m[i].end());
+	return true;
+}
+
+void matrix_batch::add(const element_type* matrix)
+{
+	elements.insert(elements.end(), matrix, matrix + n * n);
+}
+
+void matrix_batch::determinants(float_vector& result, unsigned threads) const
+{
+	result.resize(size());
+	if (!empty())
+		processBatch(data(), 0, n, size(), &result[0], 0, threads);
+}
+
+matrix_batch::size_type matrix_batch::solve(const float_vector& rhs, float_vector& x, unsigned threads) const
+{
+	if (rhs.size() != size() * n) {
+		x.clear();
+		return size();
+	}
+
+	x.resize(rhs.size());
+	return empty() ? 0 : processBatch(data(), &rhs[0], n, size(), 0, &x[0], threads);
+}
+
+}
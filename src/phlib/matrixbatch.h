@@ -0,0 +1,90 @@
+/*
+ * matrixbatch.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Batch of small square matrices of the same order stored one after another
+ * in row-major order. Determinants and solutions of linear systems are
+ * computed for all the matrices at once: several matrices are processed
+ * side by side in SIMD lanes, matrices up to 8x8 use kernels unrolled for
+ * their order, and batches may be spread over several threads.
+ */
+
+#ifndef	__MD_MATRIXBATCH_H_102938475610293847561029
+#define	__MD_MATRIXBATCH_H_102938475610293847561029
+
+#include	"floatvector.h"
+#include	"floatmatrix.h"
+#include	"densematrix.h"
+
+namespace phlib {
+
+class matrix_batch {
+public:
+	typedef double	element_type;
+	typedef size_t	size_type;
+
+	explicit matrix_batch(size_type order) : n(order) {}
+
+	// order of every matrix in batch
+	inline size_type order() const {
+		return n;
+	}
+	// number of matrices in batch
+	inline size_type size() const {
+		return n ? elements.size() / (n * n) : 0;
+	}
+	inline bool empty() const {
+		return elements.empty();
+	}
+
+	inline void clear() {
+		elements.clear();
+	}
+	inline void reserve(size_type count) {
+		elements.reserve(count * n * n);
+	}
+
+	// append matrix, returns false if its size does not match the batch order
+	bool add(const float_matrix&);
+	bool add(const dense_matrix&);
+	void add(const element_type* matrix);	// n * n elements in row-major order
+
+	inline element_type* data() {
+		return elements.empty() ? 0 : &elements[0];
+	}
+	inline const element_type* data() const {
+		return elements.empty() ? 0 : &elements[0];
+	}
+	inline element_type& at(size_type index, size_type row, size_type col) {
+		return elements[(index * n + row) * n + col];
+	}
+	inline const element_type& at(size_type index, size_type row, size_type col) const {
+		return elements[(index * n + row) * n + col];
+	}
+
+	// determinant of every matrix
+	void determinants(float_vector& result, unsigned threads = 1) const;
+
+	// solve A[k] * x[k] = rhs[k] for every matrix, right-hand sides and solutions
+	// are packed one after another; solutions of singular systems are zero
+	// returns number of singular matrices
+	size_type solve(const float_vector& rhs, float_vector& x, unsigned threads = 1) const;
+
+private:
+	size_type	n;
+	float_vector	elements;
+};
+
+}
+
+#endif	//	__MD_MATRIXBATCH_H_102938475610293847561029
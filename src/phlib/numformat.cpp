@@ -0,0 +1,426 @@
+/*
+ * numformat.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Grisu2 follows F. Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010. Cached powers of ten are computed
+ * exactly with big integers once, at the first use.
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<vector>
+#include	"numformat.h"
+
+namespace phlib {
+
+typedef unsigned long long	uint64;
+typedef unsigned int	uint32;
+
+enum {
+	SignificandBits = 52,
+	ExponentBias = 0x3FF + SignificandBits,
+	MinExponent = 1 - ExponentBias,
+
+	// cached powers are 10^-348, 10^-340, ..., 10^340
+	CachedPowers = 87,
+	FirstCachedPower = -348,
+	CachedPowerStep = 8
+};
+
+static const uint64	HiddenBit = 1ULL << SignificandBits;
+static const uint64	SignificandMask = HiddenBit - 1;
+static const uint64	ExponentMask = 0x7FF0000000000000ULL;
+static const uint64	SignMask = 0x8000000000000000ULL;
+
+// number f * 2^e
+struct DiyFp {
+	uint64	f;
+	int	e;
+
+	inline DiyFp() : f(0), e(0) {}
+	inline DiyFp(uint64 f, int e) : f(f), e(e) {}
+
+	inline DiyFp operator-(const DiyFp& v) const {
+		return DiyFp(f - v.f, e);
+	}
+
+	// upper half of 128-bit product, rounded
+	inline DiyFp operator*(const DiyFp& v) const {
+		const uint64	M32 = 0xFFFFFFFFULL;
+		const uint64	a = f >> 32, b = f & M32, c = v.f >> 32, d = v.f & M32;
+		const uint64	ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+		uint64	tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+		tmp += 1ULL << 31;
+		return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + v.e + 64);
+	}
+
+	inline DiyFp normalize() const {
+		DiyFp	r = *this;
+		while (0 == (r.f & (1ULL << 63))) {
+			r.f <<= 1;
+			r.e--;
+		}
+		return r;
+	}
+};
+
+///////////////////////////////////////////
+//
+// cached powers of ten
+//
+///////////////////////////////////////////
+
+// unsigned integer of any size, 32-bit digits from the lowest one
+class BigNumber {
+	std::vector<uint32>	digits;
+
+public:
+	explicit BigNumber(uint32 v) : digits(1, v) {}
+
+	void shiftLeft(int bits) {
+		digits.insert(digits.begin(), bits / 32, 0);
+		const int	s = bits % 32;
+		if (s > 0) {
+			uint32	carry = 0;
+			for (size_t i = 0; i < digits.size(); i++) {
+				const uint32	d = digits[i];
+				digits[i] = (d << s) | carry;
+				carry = d >> (32 - s);
+			}
+			if (carry)
+				digits.push_back(carry);
+		}
+	}
+
+	void multiply(uint32 m) {
+		uint64	carry = 0;
+		for (size_t i = 0; i < digits.size(); i++) {
+			const uint64	p = static_cast<uint64>(digits[i]) * m + carry;
+			digits[i] = static_cast<uint32>(p);
+			carry = p >> 32;
+		}
+		if (carry)
+			digits.push_back(static_cast<uint32>(carry));
+	}
+
+	// quotient is truncated
+	void divide(uint32 d) {
+		uint64	rest = 0;
+		for (size_t i = digits.size(); i-- > 0; ) {
+			const uint64	v = (rest << 32) | digits[i];
+			digits[i] = static_cast<uint32>(v / d);
+			rest = v % d;
+		}
+		while (digits.size() > 1 && 0 == digits.back())
+			digits.pop_back();
+	}
+
+	int bitLength() const {
+		int	n = static_cast<int>(digits.size() - 1) * 32;
+		for (uint32 d = digits.back(); d; d >>= 1)
+			n++;
+		return n;
+	}
+
+	inline bool bit(int i) const {
+		return 0 != ((digits[i / 32] >> (i % 32)) & 1);
+	}
+
+	// 64 upper bits rounded to nearest, number is about f * 2^e
+	DiyFp upperBits() const {
+		const int	length = bitLength();
+		const int	shift = length > 64 ? length - 64 : 0;
+
+		uint64	f = 0;
+		for (int i = length - 1; i >= shift; i--)
+			f = (f << 1) | (bit(i) ? 1 : 0);
+
+		DiyFp	r(f, shift);
+		if (shift > 0 && bit(shift - 1) && 0 == ++r.f) {
+			r.f = 1ULL << 63;
+			r.e++;
+		}
+		return r.normalize();
+	}
+};
+
+static const DiyFp* computeCachedPowers()
+{
+	static DiyFp	powers[CachedPowers];
+
+	for (int i = 0; i < CachedPowers; i++) {
+		const int	k = FirstCachedPower + i * CachedPowerStep;
+
+		if (k >= 0) {
+			BigNumber	v(1);
+			for (int j = 0; j < k; j++)
+				v.multiply(10);
+			powers[i] = v.upperBits();
+		}
+		else {
+			// 2^n / 10^-k with plenty of extra bits for rounding
+			BigNumber	p(1);
+			for (int j = 0; j < -k; j++)
+				p.multiply(10);
+			const int	n = p.bitLength() + 128;
+
+			BigNumber	v(1);
+			v.shiftLeft(n);
+			for (int j = 0; j < -k; j++)
+				v.divide(10);
+
+			powers[i] = v.upperBits();
+			powers[i].e -= n;
+		}
+	}
+
+	return powers;
+}
+
+// power of ten c such that product of c and number with binary exponent <e>
+// has binary exponent in [-60, -32]; returns c = 10^-k
+static inline DiyFp cachedPower(int e, int& k)
+{
+	static const DiyFp* const	powers = computeCachedPowers();
+
+	const double	dk = (-61 - e) * 0.30102999566398114 - FirstCachedPower - 1;
+	int	ik = static_cast<int>(dk);
+	if (dk - ik > 0.0)
+		ik++;
+
+	const int	index = (ik >> 3) + 1;
+	k = -(FirstCachedPower + index * CachedPowerStep);
+	return powers[index];
+}
+
+///////////////////////////////////////////
+//
+// Grisu2
+//
+///////////////////////////////////////////
+
+static const uint64	PowersOf10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+	1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+	1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static inline void roundWeed(char* digits, int length, uint64 delta, uint64 rest, uint64 tenKappa, uint64 distance)
+{
+	while (rest < distance && delta - rest >= tenKappa
+			&& (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+		digits[length - 1]--;
+		rest += tenKappa;
+	}
+}
+
+static inline int decimalDigits(uint32 n)
+{
+	int	d = 1;
+	while (d < 10 && n >= PowersOf10[d])
+		d++;
+	return d;
+}
+
+// digits of number between <low> and <high>, as close to <w> as possible
+static void generateDigits(const DiyFp& w, const DiyFp& high, uint64 delta, char* digits, int& length, int& k)
+{
+	const DiyFp	one(1ULL << -high.e, high.e);
+	const uint64	distance = (high - w).f;
+
+	uint32	p1 = static_cast<uint32>(high.f >> -one.e);
+	uint64	p2 = high.f & (one.f - 1);
+	int	kappa = decimalDigits(p1);
+	length = 0;
+
+	// integer part
+	while (kappa > 0) {
+		const uint32	divisor = static_cast<uint32>(PowersOf10[kappa - 1]);
+		const uint32	d = p1 / divisor;
+		p1 %= divisor;
+		if (d || length)
+			digits[length++] = static_cast<char>('0' + d);
+		kappa--;
+
+		const uint64	rest = (static_cast<uint64>(p1) << -one.e) + p2;
+		if (rest <= delta) {
+			k += kappa;
+			roundWeed(digits, length, delta, rest, PowersOf10[kappa] << -one.e, distance);
+			return;
+		}
+	}
+
+	// fractional part
+	for (;;) {
+		p2 *= 10;
+		delta *= 10;
+		const char	d = static_cast<char>(p2 >> -one.e);
+		if (d || length)
+			digits[length++] = static_cast<char>('0' + d);
+		p2 &= one.f - 1;
+		kappa--;
+
+		if (p2 < delta) {
+			k += kappa;
+			roundWeed(digits, length, delta, p2, one.f, -kappa < 20 ? distance * PowersOf10[-kappa] : 0);
+			return;
+		}
+	}
+}
+
+// positive finite <bits> is digits * 10^k
+static void grisu2(uint64 bits, char* digits, int& length, int& k)
+{
+	const int	biased = static_cast<int>((bits & ExponentMask) >> SignificandBits);
+	const uint64	significand = bits & SignificandMask;
+	const DiyFp	v = biased ? DiyFp(significand + HiddenBit, biased - ExponentBias) : DiyFp(significand, MinExponent);
+
+	// boundaries are halfway to the neighbour numbers
+	DiyFp	plus = DiyFp((v.f << 1) + 1, v.e - 1).normalize();
+	DiyFp	minus = v.f == HiddenBit && biased > 1 ? DiyFp((v.f << 2) - 1, v.e - 2) : DiyFp((v.f << 1) - 1, v.e - 1);
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	const DiyFp	c = cachedPower(plus.e, k);
+	const DiyFp	w = v.normalize() * c;
+	DiyFp	high = plus * c, low = minus * c;
+
+	// margins for rounding errors
+	low.f++;
+	high.f--;
+	generateDigits(w, high, high.f - low.f, digits, length, k);
+}
+
+static char* writeExponent(int e, char* dest)
+{
+	*dest++ = 'e';
+	if (e < 0) {
+		*dest++ = '-';
+		e = -e;
+	}
+	else
+		*dest++ = '+';
+
+	if (e >= 100) {
+		*dest++ = static_cast<char>('0' + e / 100);
+		e %= 100;
+	}
+	*dest++ = static_cast<char>('0' + e / 10);
+	*dest++ = static_cast<char>('0' + e % 10);
+	return dest;
+}
+
+// digits * 10^k in the style of "%g"
+static char* layout(const char* digits, int length, int k, char* dest)
+{
+	const int	point = length + k;	// 10^(point - 1) <= number < 10^point
+
+	if (k >= 0 && point <= 17) {
+		// 1234e2 -> 123400
+		::memcpy(dest, digits, length);
+		dest += length;
+		for (int i = 0; i < k; i++)
+			*dest++ = '0';
+	}
+	else if (point > 0 && point <= 17) {
+		// 1234e-2 -> 12.34
+		::memcpy(dest, digits, point);
+		dest += point;
+		*dest++ = '.';
+		::memcpy(dest, digits + point, length - point);
+		dest += length - point;
+	}
+	else if (point > -4 && point <= 0) {
+		// 1234e-6 -> 0.001234
+		*dest++ = '0';
+		*dest++ = '.';
+		for (int i = point; i < 0; i++)
+			*dest++ = '0';
+		::memcpy(dest, digits, length);
+		dest += length;
+	}
+	else {
+		// 1234e30 -> 1.234e+33
+		*dest++ = digits[0];
+		if (length > 1) {
+			*dest++ = '.';
+			::memcpy(dest, digits + 1, length - 1);
+			dest += length - 1;
+		}
+		dest = writeExponent(point - 1, dest);
+	}
+
+	return dest;
+}
+
+char* formatDouble(double value, char* dest, int precision)
+{
+	uint64	bits;
+	::memcpy(&bits, &value, sizeof(bits));
+
+	if (ExponentMask == (bits & ExponentMask)) {
+		const char*	s = (bits & SignificandMask) ? "nan" : (bits & SignMask) ? "-inf" : "inf";
+		const size_t	n = ::strlen(s);
+		::memcpy(dest, s, n);
+		return dest + n;
+	}
+
+	if (precision > 0) {
+		char	buffer[FormatBufferSize];
+		const int	n = ::snprintf(buffer, sizeof(buffer), "%.*g", precision < 17 ? precision : 17, value);
+		for (int i = 0; i < n; i++) {
+			const char	c = buffer[i];
+			// decimal point of the current locale
+			*dest++ = ('0' <= c && c <= '9') || '-' == c || '+' == c || 'e' == c ? c : '.';
+		}
+		return dest;
+	}
+
+	if (bits & SignMask) {
+		*dest++ = '-';
+		bits &= ~SignMask;
+	}
+	if (0 == bits) {
+		*dest++ = '0';
+		return dest;
+	}
+
+	char	digits[20];
+	int	length, k;
+	grisu2(bits, digits, length, k);
+	return layout(digits, length, k, dest);
+}
+
+char* formatInteger(long long value, char* dest)
+{
+	unsigned long long	v = static_cast<unsigned long long>(value);
+	if (value < 0) {
+		*dest++ = '-';
+		v = 0 - v;
+	}
+
+	char	buffer[20];
+	char*	p = buffer + sizeof(buffer);
+	do {
+		*--p = static_cast<char>('0' + v % 10);
+		v /= 10;
+	} while (v);
+
+	const size_t	n = buffer + sizeof(buffer) - p;
+	::memcpy(dest, p, n);
+	return dest + n;
+}
+
+}
@@ -0,0 +1,36 @@
+/*
+ * numformat.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_NUMFORMAT_H_019283746556473829101928
+#define	__MD_NUMFORMAT_H_019283746556473829101928
+
+namespace phlib {
+
+enum {
+	FormatBufferSize = 32	// enough for any number written by formatDouble()
+};
+
+// Locale-independent counterpart of parseDouble().
+// Writes the shortest decimal text that parseDouble() and strtod() read
+// back as the same value (Grisu2 algorithm), e.g. "0.1", "1234.5",
+// "1e+300", "-2.5e-07", "nan", "inf". Text is not terminated by zero.
+// With <precision> > 0 the number is rounded to so many significant
+// digits, as "%.<precision>g" does. Returns end of text.
+char* formatDouble(double value, char* dest, int precision = 0);
+
+// decimal text of integer, not terminated by zero
+char* formatInteger(long long value, char* dest);
+
+}
+
+#endif	//	__MD_NUMFORMAT_H_019283746556473829101928
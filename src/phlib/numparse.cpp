@@ -0,0 +1,158 @@
+/*
+ * numparse.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdlib.h>
+#include	<locale.h>
+#include	<ctype.h>
+#include	"numparse.h"
+
+namespace phlib {
+
+typedef unsigned long long	mantissa_type;
+
+// powers of ten exactly representable as double
+static const double	exactPowers[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+enum {
+	MaxExactPower = 22,
+	MaxDigits = 19	// significant digits fitting into mantissa_type
+};
+
+static const mantissa_type	MaxExactMantissa = 1ULL << 53;
+
+// strtod() in "C" locale
+static double slowParse(const char* begin, char** end)
+{
+#if	defined(_MSC_VER)
+	static const _locale_t	c = _create_locale(LC_ALL, "C");
+	return _strtod_l(begin, end, c);
+#elif	defined(LC_ALL_MASK)
+	static const locale_t	c = ::newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+	return ::strtod_l(begin, end, c);
+#else
+	return ::strtod(begin, end);
+#endif
+}
+
+static inline bool isDigit(char c)
+{
+	return static_cast<unsigned>(c - '0') < 10;
+}
+
+const char* parseDouble(const char* begin, const char* end, double& value)
+{
+	const char*	p = begin;
+	bool	negative = false;
+
+	if (p != end && ('-' == *p || '+' == *p))
+		negative = '-' == *p++;
+
+	// hexadecimal numbers are left to strtod()
+	if (end - p > 1 && '0' == p[0] && ('x' == p[1] || 'X' == p[1]))
+		goto slow;
+
+	{
+		mantissa_type	mantissa = 0;
+		int	digits = 0, exponent = 0;
+		bool	anyDigit = false;
+
+		for (; p != end && isDigit(*p); p++) {
+			anyDigit = true;
+			if (mantissa || '0' != *p) {
+				if (++digits > MaxDigits)
+					goto slow;
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+		}
+
+		if (p != end && '.' == *p) {
+			for (p++; p != end && isDigit(*p); p++) {
+				anyDigit = true;
+				if (mantissa || '0' != *p) {
+					if (++digits > MaxDigits)
+						goto slow;
+					mantissa = mantissa * 10 + (*p - '0');
+				}
+				exponent--;
+			}
+		}
+
+		// "inf", "nan" or not a number at all
+		if (!anyDigit)
+			goto slow;
+
+		// exponent is a part of number only if it has digits
+		if (p != end && ('e' == *p || 'E' == *p)) {
+			const char*	q = p + 1;
+			bool	negativeExp = false;
+			if (q != end && ('-' == *q || '+' == *q))
+				negativeExp = '-' == *q++;
+
+			if (q != end && isDigit(*q)) {
+				int	e = 0;
+				for (; q != end && isDigit(*q); q++)
+					if (e < 100000)
+						e = e * 10 + (*q - '0');
+				exponent += negativeExp ? -e : e;
+				p = q;
+			}
+		}
+
+		if (0 == mantissa) {
+			value = negative ? -0.0 : 0.0;
+			return p;
+		}
+
+		// Clinger's fast path: both operands are exact, so is the rounded result
+		if (mantissa <= MaxExactMantissa) {
+			double	f = static_cast<double>(mantissa);
+			bool	exact = true;
+
+			if (exponent < 0) {
+				if (exponent >= -MaxExactPower)
+					f /= exactPowers[-exponent];
+				else
+					exact = false;
+			}
+			else if (exponent > MaxExactPower) {
+				// small mantissa may absorb part of exponent exactly
+				const int	extra = exponent - MaxExactPower;
+				if (extra <= MaxExactPower && f * exactPowers[extra] < static_cast<double>(MaxExactMantissa))
+					f = f * exactPowers[extra] * exactPowers[MaxExactPower];
+				else
+					exact = false;
+			}
+			else
+				f *= exactPowers[exponent];
+
+			if (exact) {
+				value = negative ? -f : f;
+				return p;
+			}
+		}
+	}
+
+slow:
+	// strtod() would skip spaces and line feeds
+	if (begin == end || ::isspace(static_cast<unsigned char>(*begin)))
+		return begin;
+
+	char*	p1;
+	value = slowParse(begin, &p1);
+	return p1;
+}
+
+}
@@ -0,0 +1,30 @@
+/*
+ * numparse.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_NUMPARSE_H_475610293847561029384756
+#define	__MD_NUMPARSE_H_475610293847561029384756
+
+namespace phlib {
+
+// Locale-independent replacement of strtod().
+// Accepts exactly the same text as strtod() in the "C" locale and returns
+// the same correctly rounded value. Plain decimal numbers of up to 19
+// significant digits with small exponents are converted without strtod().
+// Leading spaces are not skipped. Returns end of number or <begin> if
+// text is not a number. Character at <end> must not be a part of a number,
+// e.g. separator or line feed.
+const char* parseDouble(const char* begin, const char* end, double& value);
+
+}
+
+#endif	//	__MD_NUMPARSE_H_475610293847561029384756
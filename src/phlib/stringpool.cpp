@@ -0,0 +1,72 @@
+/*
+ * stringpool.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<string.h>
+#include	"stringpool.h"
+
+namespace phlib {
+
+// FNV-1a
+string_pool::size_type string_pool::hash(const char* begin, const char* end)
+{
+	size_type	h = static_cast<size_type>(2166136261u);
+	for (; begin != end; begin++)
+		h = (h ^ static_cast<unsigned char>(*begin)) * 16777619u;
+	return h;
+}
+
+int string_pool::intern(const char* begin, const char* end)
+{
+	// table is at most half full
+	if (2 * (size() + 1) > buckets.size())
+		rehash(buckets.empty() ? 16 : 2 * buckets.size());
+
+	const size_type	n = end - begin;
+	const size_type	mask = buckets.size() - 1;
+	size_type	i = hash(begin, end) & mask;
+
+	for (; buckets[i] >= 0; i = (i + 1) & mask) {
+		const int	id = buckets[i];
+		if (length(id) == n && (0 == n || 0 == ::memcmp(&chars[offsets[id]], begin, n)))
+			return id;
+	}
+
+	const int	id = static_cast<int>(size());
+	chars.insert(chars.end(), begin, end);
+	offsets.push_back(chars.size());
+	buckets[i] = id;
+	return id;
+}
+
+void string_pool::rehash(size_type bucketCount)
+{
+	buckets.assign(bucketCount, -1);
+
+	const size_type	mask = bucketCount - 1;
+	for (int id = 0; id < static_cast<int>(size()); id++) {
+		const char*	p = data(id);
+		size_type	i = hash(p, p + length(id)) & mask;
+		while (buckets[i] >= 0)
+			i = (i + 1) & mask;
+		buckets[i] = id;
+	}
+}
+
+void string_pool::clear()
+{
+	chars.clear();
+	offsets.assign(1, 0);
+	buckets.clear();
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * stringpool.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_STRINGPOOL_H_564738291001928374650192
+#define	__MD_STRINGPOOL_H_564738291001928374650192
+
+#include	<stddef.h>
+#include	<string>
+#include	<vector>
+
+namespace phlib {
+
+// Set of distinct strings kept one after another in a single buffer.
+// Each string is identified by its number; equal strings get equal
+// numbers, so strings of a pool are compared by numbers.
+class string_pool {
+public:
+	typedef size_t	size_type;
+
+	inline string_pool() : offsets(1, 0) {}
+
+	// number of string [begin, end), the string is added if it is new
+	int intern(const char* begin, const char* end);
+	inline int intern(const std::string& s) {
+		return intern(s.data(), s.data() + s.size());
+	}
+
+	inline size_type size() const {
+		return offsets.size() - 1;
+	}
+	inline size_type length(int id) const {
+		return offsets[id + 1] - offsets[id];
+	}
+	// not terminated by zero, valid until the next string is added
+	inline const char* data(int id) const {
+		return chars.empty() ? "" : &chars[offsets[id]];
+	}
+	inline std::string str(int id) const {
+		return std::string(data(id), length(id));
+	}
+
+	void clear();
+
+private:
+	std::vector<char>	chars;
+	std::vector<size_type>	offsets;	// string i is [offsets[i], offsets[i + 1])
+	std::vector<int>	buckets;	// open addressing, -1 is empty
+
+	void rehash(size_type bucketCount);
+	static size_type hash(const char* begin, const char* end);
+};
+
+}
+
+#endif	//	__MD_STRINGPOOL_H_564738291001928374650192
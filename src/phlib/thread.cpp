@@ -0,0 +1,234 @@
+/*
+ * thread.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	"thread.h"
+#include	"namedexception.h"
+#ifdef	_MSC_VER
+#include	<windows.h>
+#else
+#include	<unistd.h>
+#endif
+
+namespace phlib {
+
+///////////////////////////////////////////
+//
+// Mutex & Condition members
+//
+///////////////////////////////////////////
+
+#ifndef	_MSC_VER
+
+Mutex::Mutex()
+{
+	::pthread_mutex_init(&handle, 0);
+}
+
+Mutex::~Mutex()
+{
+	::pthread_mutex_destroy(&handle);
+}
+
+void Mutex::lock()
+{
+	::pthread_mutex_lock(&handle);
+}
+
+void Mutex::unlock()
+{
+	::pthread_mutex_unlock(&handle);
+}
+
+Condition::Condition()
+{
+	::pthread_cond_init(&handle, 0);
+}
+
+Condition::~Condition()
+{
+	::pthread_cond_destroy(&handle);
+}
+
+void Condition::wait(Mutex& m)
+{
+	::pthread_cond_wait(&handle, &m.handle);
+}
+
+void Condition::signal()
+{
+	::pthread_cond_signal(&handle);
+}
+
+void Condition::broadcast()
+{
+	::pthread_cond_broadcast(&handle);
+}
+
+#else	//	_MSC_VER
+
+Mutex::Mutex() {}
+Mutex::~Mutex() {}
+void Mutex::lock() {}
+void Mutex::unlock() {}
+Condition::Condition() {}
+Condition::~Condition() {}
+void Condition::wait(Mutex&) {}
+void Condition::signal() {}
+void Condition::broadcast() {}
+
+#endif	//	_MSC_VER
+
+///////////////////////////////////////////
+//
+// Thread members
+//
+///////////////////////////////////////////
+
+#ifndef	_MSC_VER
+extern "C" {
+static void* threadEntry(void* arg)
+{
+	static_cast<Runnable*>(arg)->run();
+	return 0;
+}
+}
+#endif	//	_MSC_VER
+
+Thread::~Thread()
+{
+	join();
+}
+
+void Thread::start(Runnable& r)
+{
+	if (started)
+		throw NamedException("Thread is already started");
+
+#ifndef	_MSC_VER
+	if (0 != ::pthread_create(&handle, 0, threadEntry, &r))
+		throw NamedException("Cannot create thread");
+	started = true;
+#else	//	_MSC_VER
+	r.run();
+#endif	//	_MSC_VER
+}
+
+void Thread::join()
+{
+#ifndef	_MSC_VER
+	if (started) {
+		::pthread_join(handle, 0);
+		started = false;
+	}
+#endif	//	_MSC_VER
+}
+
+unsigned Thread::hardwareConcurrency()
+{
+#ifdef	_MSC_VER
+	SYSTEM_INFO	info;
+	::GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else	//	_MSC_VER
+	long	n = ::sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? static_cast<unsigned>(n) : 1;
+#endif	//	_MSC_VER
+}
+
+///////////////////////////////////////////
+//
+// ThreadPool members
+//
+///////////////////////////////////////////
+
+ThreadPool::ThreadPool(unsigned threads) : pending(0), stopping(false), worker(*this)
+{
+#ifndef	_MSC_VER
+	if (0 == threads)
+		threads = Thread::hardwareConcurrency();
+
+	try {
+		while (workers.size() < threads) {
+			workers.push_back(new Thread);
+			workers.back()->start(worker);
+		}
+	}
+	catch (...) {
+		shutdown();
+		throw;
+	}
+#endif	//	_MSC_VER
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+	shutdown();
+}
+
+void ThreadPool::shutdown()
+{
+	{
+		ScopedLock	lock(mutex);
+		stopping = true;
+		hasWork.broadcast();
+	}
+
+	for (std::vector<Thread*>::iterator i = workers.begin(); i != workers.end(); i++)
+		delete *i;
+	workers.clear();
+}
+
+void ThreadPool::submit(Runnable& task)
+{
+	if (workers.empty()) {
+		task.run();
+		return;
+	}
+
+	ScopedLock	lock(mutex);
+	queue.push_back(&task);
+	pending++;
+	hasWork.signal();
+}
+
+void ThreadPool::wait()
+{
+	ScopedLock	lock(mutex);
+	while (pending > 0)
+		allDone.wait(mutex);
+}
+
+void ThreadPool::Worker::run()
+{
+	for (;;) {
+		Runnable*	task;
+		{
+			ScopedLock	lock(pool.mutex);
+			while (pool.queue.empty() && !pool.stopping)
+				pool.hasWork.wait(pool.mutex);
+			if (pool.queue.empty())
+				return;
+			task = pool.queue.front();
+			pool.queue.pop_front();
+		}
+
+		task->run();
+
+		ScopedLock	lock(pool.mutex);
+		if (0 == --pool.pending)
+			pool.allDone.broadcast();
+	}
+}
+
+}
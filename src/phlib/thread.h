@@ -0,0 +1,149 @@
+/*
+ * thread.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Minimal threading primitives on top of POSIX threads.
+ * When built with MSVC there are no worker threads: Thread::start() and
+ * ThreadPool::submit() run the task synchronously in the calling thread.
+ */
+
+#ifndef	__MD_THREAD_H_384756102938475610293847561
+#define	__MD_THREAD_H_384756102938475610293847561
+
+#include	<stddef.h>
+#include	<vector>
+#include	<deque>
+#ifndef	_MSC_VER
+#include	<pthread.h>
+#endif
+
+namespace phlib {
+
+class Runnable {
+public:
+	virtual ~Runnable() {}
+	virtual void run() = 0;
+};
+
+class Mutex {
+#ifndef	_MSC_VER
+	pthread_mutex_t	handle;
+#endif
+
+	friend class Condition;
+
+	Mutex(const Mutex&);
+	Mutex& operator=(const Mutex&);
+
+public:
+	Mutex();
+	~Mutex();
+
+	void lock();
+	void unlock();
+};
+
+class ScopedLock {
+	Mutex&	mutex;
+
+	ScopedLock(const ScopedLock&);
+	ScopedLock& operator=(const ScopedLock&);
+
+public:
+	explicit ScopedLock(Mutex& m) : mutex(m) {
+		mutex.lock();
+	}
+
+	~ScopedLock() {
+		mutex.unlock();
+	}
+};
+
+class Condition {
+#ifndef	_MSC_VER
+	pthread_cond_t	handle;
+#endif
+
+	Condition(const Condition&);
+	Condition& operator=(const Condition&);
+
+public:
+	Condition();
+	~Condition();
+
+	// mutex must be locked by the caller
+	void wait(Mutex&);
+	void signal();
+	void broadcast();
+};
+
+// single thread running a task; the task is not owned
+class Thread {
+#ifndef	_MSC_VER
+	pthread_t	handle;
+#endif
+	bool	started;
+
+	Thread(const Thread&);
+	Thread& operator=(const Thread&);
+
+public:
+	Thread() : started(false) {}
+	~Thread();	// joins the thread
+
+	void start(Runnable&);
+	void join();
+
+	static unsigned hardwareConcurrency();
+};
+
+// fixed set of worker threads executing submitted tasks; tasks are not owned
+class ThreadPool {
+	std::vector<Thread*>	workers;
+	std::deque<Runnable*>	queue;
+	Mutex	mutex;
+	Condition	hasWork, allDone;
+	size_t	pending;
+	bool	stopping;
+
+	class Worker : public Runnable {
+		ThreadPool&	pool;
+	public:
+		Worker(ThreadPool& pool) : pool(pool) {}
+		virtual void run();
+	};
+	Worker	worker;
+
+	void shutdown();
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+public:
+	// threads == 0 means "as many as CPU cores"
+	explicit ThreadPool(unsigned threads = 0);
+	~ThreadPool();	// waits for all submitted tasks
+
+	inline unsigned size() const {
+		return static_cast<unsigned>(workers.size());
+	}
+
+	void submit(Runnable&);
+
+	// wait until all submitted tasks are complete
+	void wait();
+};
+
+}
+
+#endif	//	__MD_THREAD_H_384756102938475610293847561
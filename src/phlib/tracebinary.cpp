@@ -0,0 +1,365 @@
+/*
+ * tracebinary.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<algorithm>
+#include	<zlib.h>
+#include	"tracebinary.h"
+
+namespace phlib {
+
+enum {
+	BinaryVersion = 1,
+	HeaderSize = 16,	// magic, version and reserved word
+	RecordHeaderSize = 16,
+	RecordAlignment = 8,
+	MaxDeflateRatio = 1032	// zlib cannot compress better
+};
+
+enum {
+	recordTypeTitles = 1,
+	recordTypeRows = 2,
+	recordTypeDeflatedRows = 3
+};
+
+static const char	BinaryMagic[8] = {'P', 'H', 'T', 'R', 'B', 'I', 'N', '1'};
+
+static inline bool isLittleEndian()
+{
+	const unsigned short	v = 1;
+	return 1 == *reinterpret_cast<const unsigned char*>(&v);
+}
+
+static inline void putWord(char* p, unsigned v)
+{
+	for (int i = 0; i < 4; i++, v >>= 8)
+		p[i] = static_cast<char>(v & 0xff);
+}
+
+static inline unsigned getWord(const char* p)
+{
+	const unsigned char*	u = reinterpret_cast<const unsigned char*>(p);
+	return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<unsigned>(u[3]) << 24);
+}
+
+// doubles are stored little-endian
+static void swapBytes(double* values, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		char*	p = reinterpret_cast<char*>(values + i);
+		std::reverse(p, p + sizeof(double));
+	}
+}
+
+static inline size_t padded(size_t size)
+{
+	return (size + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+}
+
+///////////////////////////////////////////
+//
+// BinaryTraceWriter members
+//
+///////////////////////////////////////////
+
+BinaryTraceWriter::BinaryTraceWriter(const std::string& fileName, int level, bool do_open) : FileChecker(fileName),
+		level(std::min(std::max(level, 0), 9)), blockRows(0), blockColumns(0), error(false)
+{
+	if (do_open)
+		open(fileName);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter()
+{
+	close();
+}
+
+void BinaryTraceWriter::open(const std::string& fileName)
+{
+	const std::ios_base::openmode	mode = getFileOpenMode(fileName);
+	const std::string	name = getFileName(fileName);
+	if (0 == mode || name.empty())
+		return;
+
+	file.open(name.c_str(), mode | std::ios_base::out | std::ios_base::binary);
+	if (!file.is_open()) {
+		error = true;
+		return;
+	}
+
+	if (isHeaderRequired()) {
+		char	header[HeaderSize] = {0};
+		::memcpy(header, BinaryMagic, sizeof(BinaryMagic));
+		putWord(header + sizeof(BinaryMagic), BinaryVersion);
+		if (!file.write(header, sizeof(header)))
+			error = true;
+	}
+}
+
+void BinaryTraceWriter::writeRecord(unsigned type, unsigned count, unsigned columns, const char* payload, size_t size)
+{
+	if (!file.is_open() || error)
+		return;
+
+	char	header[RecordHeaderSize];
+	putWord(header, type);
+	putWord(header + 4, count);
+	putWord(header + 8, columns);
+	putWord(header + 12, static_cast<unsigned>(size));
+
+	static const char	padding[RecordAlignment] = {0};
+	if (!file.write(header, sizeof(header)) || !file.write(payload, size)
+			|| !file.write(padding, padded(size) - size))
+		error = true;
+}
+
+void BinaryTraceWriter::writeTitles(const std::vector<std::string>& titles)
+{
+	writeBlock();
+
+	record.clear();
+	for (std::vector<std::string>::const_iterator i = titles.begin(); i != titles.end(); i++) {
+		char	length[4];
+		putWord(length, static_cast<unsigned>(i->size()));
+		record.insert(record.end(), length, length + sizeof(length));
+		record.insert(record.end(), i->begin(), i->end());
+	}
+
+	writeRecord(recordTypeTitles, static_cast<unsigned>(titles.size()), 0,
+		record.empty() ? 0 : &record[0], record.size());
+}
+
+void BinaryTraceWriter::endLine()
+{
+	writeLine(row);
+	row.clear();
+}
+
+void BinaryTraceWriter::writeLine(const float_vector& v)
+{
+	writeLine(v.empty() ? 0 : &v[0], v.size());
+}
+
+void BinaryTraceWriter::writeLine(const double* values, size_t count)
+{
+	if (0 == count)
+		return;
+
+	if (count != blockColumns) {
+		writeBlock();
+		blockColumns = count;
+	}
+
+	block.insert(block.end(), values, values + count);
+	blockRows++;
+
+	if (block.size() * sizeof(double) >= BlockSize)
+		writeBlock();
+}
+
+void BinaryTraceWriter::writeBlock()
+{
+	if (0 == blockRows)
+		return;
+
+	if (!isLittleEndian())
+		swapBytes(&block[0], block.size());
+
+	const char*	data = reinterpret_cast<const char*>(&block[0]);
+	const size_t	size = block.size() * sizeof(double);
+	bool	deflated = false;
+
+	if (level > 0) {
+		uLongf	length = ::compressBound(static_cast<uLong>(size));
+		record.resize(length);
+		deflated = Z_OK == ::compress2(reinterpret_cast<Bytef*>(&record[0]), &length,
+			reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size), level) && length < size;
+		if (deflated)
+			writeRecord(recordTypeDeflatedRows, static_cast<unsigned>(blockRows), static_cast<unsigned>(blockColumns),
+				&record[0], length);
+	}
+
+	// data that cannot be compressed is stored as is
+	if (!deflated)
+		writeRecord(recordTypeRows, static_cast<unsigned>(blockRows), static_cast<unsigned>(blockColumns), data, size);
+
+	block.clear();
+	blockRows = 0;
+}
+
+void BinaryTraceWriter::flush()
+{
+	writeBlock();
+	if (file.is_open() && !file.flush())
+		error = true;
+}
+
+void BinaryTraceWriter::close()
+{
+	if (!row.empty())
+		endLine();
+	writeBlock();
+
+	if (file.is_open()) {
+		file.close();
+		if (file.fail())
+			error = true;
+	}
+}
+
+///////////////////////////////////////////
+//
+// BinaryTraceScanner members
+//
+///////////////////////////////////////////
+
+BinaryTraceScanner::BinaryTraceScanner(const char* begin, const char* end) : position(begin), end(end),
+		damage(false), rowCount(0), columnCount(0), data(0)
+{
+	if (!isBinary(begin, end - begin) || getWord(begin + sizeof(BinaryMagic)) > BinaryVersion) {
+		damage = true;
+		position = end;
+	}
+	else
+		position += HeaderSize;
+}
+
+bool BinaryTraceScanner::isBinary(const char* data, size_t size)
+{
+	return size >= HeaderSize && 0 == ::memcmp(data, BinaryMagic, sizeof(BinaryMagic));
+}
+
+bool BinaryTraceScanner::isBinaryFile(const char* filename)
+{
+	FILE*	f = ::fopen(filename, "rb");
+	if (!f)
+		return false;
+
+	char	header[HeaderSize];
+	const size_t	n = ::fread(header, 1, sizeof(header), f);
+	::fclose(f);
+	return isBinary(header, n);
+}
+
+BinaryTraceScanner::Record BinaryTraceScanner::next()
+{
+	for (;;) {
+		if (static_cast<size_t>(end - position) < RecordHeaderSize) {
+			damage = damage || position != end;
+			position = end;
+			return recordEnd;
+		}
+
+		const unsigned	type = getWord(position), count = getWord(position + 4);
+		const unsigned	columns = getWord(position + 8), size = getWord(position + 12);
+		const char*	payload = position + RecordHeaderSize;
+
+		if (static_cast<size_t>(end - payload) < padded(size)) {
+			damage = true;
+			position = end;
+			return recordEnd;
+		}
+		position = payload + padded(size);
+
+		switch (type) {
+			case recordTypeTitles:
+				if (readTitles(payload, count, size))
+					return recordTitles;
+				break;
+
+			case recordTypeRows:
+			case recordTypeDeflatedRows:
+				rowCount = count;
+				columnCount = columns;
+				if (readRows(payload, type, size))
+					return recordRows;
+				break;
+
+			default:
+				continue;
+		}
+
+		damage = true;
+		position = end;
+		return recordEnd;
+	}
+}
+
+bool BinaryTraceScanner::readTitles(const char* p, unsigned count, size_t size)
+{
+	const char*	stop = p + size;
+
+	// every title takes at least its length word, so a damaged count
+	// is rejected before memory is allocated for it
+	if (count > size / 4)
+		return false;
+
+	titleList.resize(count);
+	for (unsigned i = 0; i < count; i++) {
+		if (stop - p < 4)
+			return false;
+		const size_t	length = getWord(p);
+		p += 4;
+		if (static_cast<size_t>(stop - p) < length)
+			return false;
+		titleList[i].assign(p, length);
+		p += length;
+	}
+	return true;
+}
+
+bool BinaryTraceScanner::readRows(const char* p, unsigned type, size_t size)
+{
+	// rows and columns are taken from the file, their product is checked
+	// against the payload before byte count is computed, which may wrap
+	const unsigned long long	limit = recordTypeRows == type ? size / sizeof(double)
+			: static_cast<unsigned long long>(size) * MaxDeflateRatio / sizeof(double);
+	if (0 == columnCount ? 0 != rowCount : rowCount > limit / columnCount)
+		return false;
+
+	const unsigned long long	count = static_cast<unsigned long long>(rowCount) * columnCount;
+
+	if (recordTypeRows == type) {
+		if (count * sizeof(double) != size)
+			return false;
+
+		// values are used in place when possible
+		if (isLittleEndian() && 0 == reinterpret_cast<size_t>(p) % sizeof(double)) {
+			data = reinterpret_cast<const double*>(p);
+			return true;
+		}
+
+		buffer.resize(count);
+		if (count > 0)
+			::memcpy(&buffer[0], p, size);
+	}
+	else {
+		if (0 == count)
+			return false;
+
+		buffer.resize(count);
+		uLongf	length = static_cast<uLongf>(count * sizeof(double));
+		if (Z_OK != ::uncompress(reinterpret_cast<Bytef*>(&buffer[0]), &length,
+				reinterpret_cast<const Bytef*>(p), static_cast<uLong>(size))
+				|| length != count * sizeof(double))
+			return false;
+	}
+
+	if (!isLittleEndian() && count > 0)
+		swapBytes(&buffer[0], buffer.size());
+	data = buffer.empty() ? 0 : &buffer[0];
+	return true;
+}
+
+}
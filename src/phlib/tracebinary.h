@@ -0,0 +1,165 @@
+/*
+ * tracebinary.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Binary trace files, a compact alternative to text written by
+ * TraceStream. A file starts with magic "PHTRBIN1" and format version,
+ * records follow. A record has a header of four 32-bit words (type, count,
+ * columns, payload size) and payload padded to 8 bytes. Titles record
+ * holds <count> column titles, each as length and characters; rows record
+ * holds <count> rows of <columns> doubles, row after row, deflated in
+ * compressed records. All numbers are little-endian. Records are only
+ * appended, so "+name" files grow as text ones do. TraceReader recognizes
+ * binary files by the magic and passes their data to the same handlers.
+ */
+
+#ifndef	__MD_TRACEBINARY_H_102938475647382910293847
+#define	__MD_TRACEBINARY_H_102938475647382910293847
+
+#include	<stddef.h>
+#include	<string>
+#include	<vector>
+#include	<fstream>
+#include	"tracestream.h"
+#include	"floatvector.h"
+
+namespace phlib {
+
+// Writes binary trace files. File names follow TraceStream rules: "+name"
+// appends to the file and empty name opens nothing. Rows of the same width
+// are collected into blocks of about BlockSize bytes.
+class BinaryTraceWriter : protected FileChecker {
+	std::ofstream	file;
+	int	level;
+	std::vector<double>	block;	// rows of the same width
+	size_t	blockRows, blockColumns;
+	float_vector	row;	// row being written with operator<<
+	std::vector<char>	record;
+	bool	error;
+
+	void open(const std::string& fileName);
+	void writeRecord(unsigned type, unsigned count, unsigned columns, const char* payload, size_t size);
+	void writeBlock();
+
+	BinaryTraceWriter(const BinaryTraceWriter&);
+	BinaryTraceWriter& operator=(const BinaryTraceWriter&);
+
+public:
+	enum {BlockSize = 256 * 1024};
+
+	// blocks are deflated with compression <level> 1..9, 0 means no compression
+	explicit BinaryTraceWriter(const std::string& fileName, int level = 0, bool do_open = true);
+	virtual ~BinaryTraceWriter();	// buffered rows are written
+
+	inline bool isOpen() const {
+		return file.is_open();
+	}
+
+	inline bool isHeaderRequired() const {
+		return isNew() || getInitialFileSize() == 0;
+	}
+
+	void writeTitles(const std::vector<std::string>& titles);
+
+	// values of the current row
+	inline BinaryTraceWriter& operator<<(double v) {
+		row.push_back(v);
+		return *this;
+	}
+
+	inline BinaryTraceWriter& operator<<(int v) {
+		row.push_back(v);
+		return *this;
+	}
+
+	// line feed finishes the current row, separators are ignored
+	inline BinaryTraceWriter& operator<<(char c) {
+		if ('\n' == c)
+			endLine();
+		return *this;
+	}
+
+	void endLine();
+
+	// rows without values are not written
+	void writeLine(const float_vector& v);
+	void writeLine(const double* values, size_t count);
+
+	// writes collected rows
+	void flush();
+
+	// writes all data and closes the file
+	void close();
+
+	// data cannot be written
+	inline bool failed() const {
+		return error;
+	}
+};
+
+// sequential reader of records of binary trace file data
+class BinaryTraceScanner {
+	const char	*position, *end;
+	bool	damage;
+	std::vector<std::string>	titleList;
+	size_t	rowCount, columnCount;
+	const double*	data;
+	std::vector<double>	buffer;	// inflated or byte swapped values
+
+	bool readTitles(const char* p, unsigned count, size_t size);
+	bool readRows(const char* p, unsigned type, size_t size);
+
+	BinaryTraceScanner(const BinaryTraceScanner&);
+	BinaryTraceScanner& operator=(const BinaryTraceScanner&);
+
+public:
+	enum Record {
+		recordEnd,
+		recordTitles,
+		recordRows
+	};
+
+	// [begin, end) holds the whole file
+	BinaryTraceScanner(const char* begin, const char* end);
+
+	// data starts with binary trace magic
+	static bool isBinary(const char* data, size_t size);
+	static bool isBinaryFile(const char* filename);
+
+	// moves to the next record, records of unknown types are skipped
+	Record next();
+
+	// file has bad header or the last record is incomplete
+	inline bool damaged() const {
+		return damage;
+	}
+
+	// contents of the current record
+	inline const std::vector<std::string>& titles() const {
+		return titleList;
+	}
+	inline size_t rows() const {
+		return rowCount;
+	}
+	inline size_t columns() const {
+		return columnCount;
+	}
+	// rows() * columns() values, row after row
+	inline const double* values() const {
+		return data;
+	}
+};
+
+}
+
+#endif	//	__MD_TRACEBINARY_H_102938475647382910293847
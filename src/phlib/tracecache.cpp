@@ -0,0 +1,335 @@
+/*
+ * tracecache.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<sys/types.h>
+#include	<sys/stat.h>
+#include	<stdio.h>
+#include	<string.h>
+#include	<limits.h>
+#include	<algorithm>
+#include	<fstream>
+#include	"tracecache.h"
+
+namespace phlib {
+
+enum {
+	CacheVersion = 1,
+	ByteOrderMark = 0x01020304,
+	DataAlignment = 64
+};
+
+static const char	CacheMagic[8] = {'P', 'H', 'T', 'R', 'C', 'A', 'C', 'H'};
+
+// file starts with this header
+// all offsets are from the beginning of file
+struct TraceCache::Header {
+	char	magic[8];
+	unsigned	version;
+	unsigned	byteOrder;
+	unsigned long long	sourceSize;
+	long long	sourceMtime;
+	long long	sourceMtimeNanoseconds;
+	unsigned long long	rows;
+	unsigned	columns;
+	unsigned	titleCount;
+	unsigned long long	trailingLines;
+	unsigned long long	titlesOffset;	// length and characters of each title
+	unsigned long long	precisionsOffset;	// int per column
+	unsigned long long	valuesOffset;	// doubles, column after column
+	unsigned long long	cellsOffset;	// cell kinds, column after column
+	unsigned long long	skippedOffset;	// unsigned per row
+	unsigned long long	fileSize;
+};
+
+static inline unsigned long long alignUp(unsigned long long offset, unsigned long long alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+///////////////////////////////////////////
+//
+// TraceSourceStamp members
+//
+///////////////////////////////////////////
+
+bool TraceSourceStamp::read(const char* filename)
+{
+	struct stat	st;
+	if (0 != ::stat(filename, &st))
+		return false;
+
+	size = st.st_size;
+	mtime = st.st_mtime;
+#ifdef	__linux__
+	mtimeNanoseconds = st.st_mtim.tv_nsec;
+#else
+	mtimeNanoseconds = 0;
+#endif
+	return true;
+}
+
+///////////////////////////////////////////
+//
+// TraceCache members
+//
+///////////////////////////////////////////
+
+std::string TraceCache::nameFor(const char* filename)
+{
+	return std::string(filename) + ".phcache";
+}
+
+bool TraceCache::open(const char* filename)
+{
+	close();
+
+	TraceSourceStamp	source;
+	if (!source.read(filename) || !map.open(nameFor(filename).c_str(), false))
+		return false;
+
+	const unsigned long long	size = map.size();
+	const Header*	h = reinterpret_cast<const Header*>(map.data());
+
+	// reject foreign, stale and truncated files
+	bool	valid = size >= sizeof(Header)
+		&& 0 == ::memcmp(h->magic, CacheMagic, sizeof(CacheMagic))
+		&& CacheVersion == h->version && ByteOrderMark == h->byteOrder
+		&& size == h->fileSize
+		&& source.size == h->sourceSize && source.mtime == h->sourceMtime
+		&& source.mtimeNanoseconds == h->sourceMtimeNanoseconds
+		&& h->rows <= size && h->columns <= size
+		&& h->precisionsOffset + h->columns * sizeof(int) <= size
+		&& h->valuesOffset + h->rows * h->columns * sizeof(double) <= size
+		&& h->cellsOffset + h->rows * h->columns <= size
+		&& h->skippedOffset + h->rows * sizeof(unsigned) <= size
+		&& h->titlesOffset <= size;
+
+	const char	*p = map.data() + (valid ? h->titlesOffset : 0), *end = map.data() + size;
+	for (unsigned i = 0; valid && i < h->titleCount; i++) {
+		unsigned	length;
+		valid = static_cast<size_t>(end - p) >= sizeof(length);
+		if (valid) {
+			::memcpy(&length, p, sizeof(length));
+			p += sizeof(length);
+			valid = static_cast<size_t>(end - p) >= length;
+		}
+		if (valid) {
+			titleList.push_back(std::string(p, length));
+			p += length;
+		}
+	}
+
+	if (!valid) {
+		close();
+		return false;
+	}
+
+	header = h;
+	return true;
+}
+
+void TraceCache::close()
+{
+	header = 0;
+	titleList.clear();
+	map.close();
+}
+
+size_t TraceCache::rows() const
+{
+	return static_cast<size_t>(header->rows);
+}
+
+int TraceCache::columns() const
+{
+	return static_cast<int>(header->columns);
+}
+
+const double* TraceCache::column(int index) const
+{
+	return reinterpret_cast<const double*>(map.data() + header->valuesOffset) + index * rows();
+}
+
+const unsigned char* TraceCache::cells(int index) const
+{
+	return reinterpret_cast<const unsigned char*>(map.data() + header->cellsOffset) + index * rows();
+}
+
+int TraceCache::precision(int index) const
+{
+	return reinterpret_cast<const int*>(map.data() + header->precisionsOffset)[index];
+}
+
+const unsigned* TraceCache::skippedLines() const
+{
+	return reinterpret_cast<const unsigned*>(map.data() + header->skippedOffset);
+}
+
+unsigned long long TraceCache::trailingLines() const
+{
+	return header->trailingLines;
+}
+
+///////////////////////////////////////////
+//
+// TraceCacheBuilder members
+//
+///////////////////////////////////////////
+
+void TraceCacheBuilder::startLine()
+{
+	line.clear();
+	lineHasNumbers = false;
+}
+
+void TraceCacheBuilder::addNumber(int index, double value, int precision)
+{
+	const Cell	c = {index, precision, value};
+	line.push_back(c);
+	lineHasNumbers = true;
+}
+
+void TraceCacheBuilder::addText(int index)
+{
+	const Cell	c = {index, 0, 0.0};
+	line.push_back(c);
+}
+
+void TraceCacheBuilder::finishLine()
+{
+	if (!lineHasNumbers) {
+		pendingLines++;
+		return;
+	}
+
+	// new columns are empty in previous rows
+	for (std::vector<Cell>::const_iterator i = line.begin(); i != line.end(); i++)
+		while (static_cast<int>(values.size()) <= i->index) {
+			values.push_back(std::vector<double>(rowCount, 0.0));
+			kinds.push_back(std::vector<unsigned char>(rowCount, TraceCache::cellNone));
+			precisions.push_back(0);
+		}
+
+	for (size_t c = 0; c < values.size(); c++) {
+		values[c].push_back(0.0);
+		kinds[c].push_back(TraceCache::cellNone);
+	}
+
+	for (std::vector<Cell>::const_iterator i = line.begin(); i != line.end(); i++) {
+		if (i->precision > 0) {
+			values[i->index].back() = i->value;
+			kinds[i->index].back() = TraceCache::cellNumber;
+			precisions[i->index] = std::max(precisions[i->index], i->precision);
+		}
+		else
+			kinds[i->index].back() = TraceCache::cellText;
+	}
+
+	skipped.push_back(static_cast<unsigned>(std::min<unsigned long long>(pendingLines, UINT_MAX)));
+	pendingLines = 0;
+	rowCount++;
+}
+
+static void pad(std::ostream& dest, unsigned long long& offset, unsigned long long alignment)
+{
+	static const char	zeros[DataAlignment] = {0};
+	const unsigned long long	aligned = alignUp(offset, alignment);
+	dest.write(zeros, aligned - offset);
+	offset = aligned;
+}
+
+bool TraceCacheBuilder::write(const char* cacheName, const std::vector<std::string>& titles,
+		const TraceSourceStamp& source) const
+{
+	const std::string	tempName = std::string(cacheName) + ".tmp";
+	const unsigned	columns = static_cast<unsigned>(values.size());
+
+	TraceCache::Header	h;
+	::memset(&h, 0, sizeof(h));
+	::memcpy(h.magic, CacheMagic, sizeof(CacheMagic));
+	h.version = CacheVersion;
+	h.byteOrder = ByteOrderMark;
+	h.sourceSize = source.size;
+	h.sourceMtime = source.mtime;
+	h.sourceMtimeNanoseconds = source.mtimeNanoseconds;
+	h.rows = rowCount;
+	h.columns = columns;
+	h.titleCount = static_cast<unsigned>(titles.size());
+	h.trailingLines = pendingLines;
+
+	unsigned long long	offset = sizeof(h);
+	h.titlesOffset = offset;
+	for (std::vector<std::string>::const_iterator i = titles.begin(); i != titles.end(); i++)
+		offset += sizeof(unsigned) + i->size();
+	h.precisionsOffset = offset = alignUp(offset, sizeof(int));
+	offset += columns * sizeof(int);
+	h.valuesOffset = offset = alignUp(offset, DataAlignment);
+	offset += rowCount * columns * sizeof(double);
+	h.cellsOffset = offset;
+	offset += rowCount * columns;
+	h.skippedOffset = offset = alignUp(offset, sizeof(unsigned));
+	offset += rowCount * sizeof(unsigned);
+	h.fileSize = offset;
+
+	{
+		std::ofstream	dest(tempName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!dest.is_open())
+			return false;
+
+		dest.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		offset = sizeof(h);
+
+		for (std::vector<std::string>::const_iterator i = titles.begin(); i != titles.end(); i++) {
+			const unsigned	length = static_cast<unsigned>(i->size());
+			dest.write(reinterpret_cast<const char*>(&length), sizeof(length));
+			dest.write(i->data(), length);
+			offset += sizeof(length) + length;
+		}
+
+		pad(dest, offset, sizeof(int));
+		if (columns > 0)
+			dest.write(reinterpret_cast<const char*>(&precisions[0]), columns * sizeof(int));
+		offset += columns * sizeof(int);
+
+		pad(dest, offset, DataAlignment);
+		if (rowCount > 0) {
+			for (unsigned c = 0; c < columns; c++)
+				dest.write(reinterpret_cast<const char*>(&values[c][0]), rowCount * sizeof(double));
+			for (unsigned c = 0; c < columns; c++)
+				dest.write(reinterpret_cast<const char*>(&kinds[c][0]), rowCount);
+		}
+		offset += rowCount * columns * (sizeof(double) + 1);
+
+		pad(dest, offset, sizeof(unsigned));
+		if (rowCount > 0)
+			dest.write(reinterpret_cast<const char*>(&skipped[0]), rowCount * sizeof(unsigned));
+
+		dest.close();
+		if (!dest) {
+			::remove(tempName.c_str());
+			return false;
+		}
+	}
+
+#ifdef	_MSC_VER
+	// rename() does not replace existing files there
+	::remove(cacheName);
+#endif
+	if (0 != ::rename(tempName.c_str(), cacheName)) {
+		::remove(tempName.c_str());
+		return false;
+	}
+	return true;
+}
+
+}
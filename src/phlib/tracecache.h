@@ -0,0 +1,130 @@
+/*
+ * tracecache.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Binary columnar copy of a parsed trace file, kept next to it as
+ * <filename>.phcache. Only data lines are stored: a row per line having
+ * at least one number, and a contiguous array of doubles per column.
+ * Cache is valid while size and modification time of the source file
+ * are the same as recorded. Files are in native byte order.
+ */
+
+#ifndef	__MD_TRACECACHE_H_564738291056473829105647
+#define	__MD_TRACECACHE_H_564738291056473829105647
+
+#include	<stddef.h>
+#include	<string>
+#include	<vector>
+#include	"mappedfile.h"
+
+namespace phlib {
+
+// identifies the version of source file cache is built from
+struct TraceSourceStamp {
+	unsigned long long	size;
+	long long	mtime;
+	long	mtimeNanoseconds;
+
+	// false if file does not exist
+	bool read(const char* filename);
+
+	inline bool operator==(const TraceSourceStamp& v) const {
+		return size == v.size && mtime == v.mtime && mtimeNanoseconds == v.mtimeNanoseconds;
+	}
+};
+
+class TraceCache {
+public:
+	// kinds of cells
+	enum {
+		cellNone,	// line has no such column
+		cellNumber,
+		cellText	// text field among numbers
+	};
+
+	inline TraceCache() : header(0) {}
+
+	static std::string nameFor(const char* filename);
+
+	// opens cache of <filename>, returns false if cache is missing, damaged
+	// or built from another version of the file
+	bool open(const char* filename);
+	void close();
+
+	inline bool isOpen() const {
+		return 0 != header;
+	}
+
+	size_t rows() const;
+	int columns() const;
+
+	// <rows()> values of column, cells of other kinds hold zeros
+	const double* column(int index) const;
+	const unsigned char* cells(int index) const;
+	// maximal number of characters of numbers in column
+	int precision(int index) const;
+
+	// number of lines without numbers preceding each row
+	const unsigned* skippedLines() const;
+	// number of lines without numbers after the last row
+	unsigned long long trailingLines() const;
+
+	inline const std::vector<std::string>& titles() const {
+		return titleList;
+	}
+
+private:
+	struct Header;
+	friend class TraceCacheBuilder;
+
+	MappedFile	map;
+	const Header*	header;
+	std::vector<std::string>	titleList;
+
+	TraceCache(const TraceCache&);
+	TraceCache& operator=(const TraceCache&);
+};
+
+// collects parsed lines and writes them as cache
+class TraceCacheBuilder {
+	struct Cell {
+		int	index;
+		int	precision;	// 0 for text
+		double	value;
+	};
+
+	std::vector<Cell>	line;
+	bool	lineHasNumbers;
+	size_t	rowCount;
+	std::vector<std::vector<double> >	values;
+	std::vector<std::vector<unsigned char> >	kinds;
+	std::vector<int>	precisions;
+	std::vector<unsigned>	skipped;
+	unsigned long long	pendingLines;	// lines without numbers since the last row
+
+public:
+	inline TraceCacheBuilder() : lineHasNumbers(false), rowCount(0), pendingLines(0) {}
+
+	void startLine();
+	void addNumber(int index, double value, int precision);
+	void addText(int index);
+	void finishLine();
+
+	// file is written under temporary name and renamed then
+	bool write(const char* cacheName, const std::vector<std::string>& titles,
+			const TraceSourceStamp& source) const;
+};
+
+}
+
+#endif	//	__MD_TRACECACHE_H_564738291056473829105647
@@ -0,0 +1,139 @@
+/*
+ * traceindex.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<fstream>
+#include	"traceindex.h"
+
+namespace phlib {
+
+enum {
+	IndexVersion = 1,
+	ByteOrderMark = 0x01020304
+};
+
+static const char	IndexMagic[8] = {'P', 'H', 'T', 'R', 'I', 'N', 'D', 'X'};
+
+// file starts with this header, entries follow
+struct IndexHeader {
+	char	magic[8];
+	unsigned	version;
+	unsigned	byteOrder;
+	unsigned long long	sourceSize;
+	long long	sourceMtime;
+	long long	sourceMtimeNanoseconds;
+	unsigned long long	rows;
+	unsigned long long	entries;
+	unsigned	step;
+	unsigned	reserved;
+};
+
+std::string TraceIndex::nameFor(const char* filename)
+{
+	return std::string(filename) + ".phindex";
+}
+
+bool TraceIndex::open(const char* filename)
+{
+	TraceSourceStamp	source;
+	if (!source.read(filename))
+		return false;
+
+	std::ifstream	src(nameFor(filename).c_str(), std::ios_base::in | std::ios_base::binary);
+	if (!src.is_open())
+		return false;
+
+	IndexHeader	h;
+	if (!src.read(reinterpret_cast<char*>(&h), sizeof(h)))
+		return false;
+
+	// reject foreign and stale files
+	if (0 != ::memcmp(h.magic, IndexMagic, sizeof(IndexMagic))
+			|| IndexVersion != h.version || ByteOrderMark != h.byteOrder
+			|| source.size != h.sourceSize || source.mtime != h.sourceMtime
+			|| source.mtimeNanoseconds != h.sourceMtimeNanoseconds
+			|| 0 == h.step || h.entries != (h.rows + h.step - 1) / h.step
+			|| h.entries > h.sourceSize)
+		return false;
+
+	std::vector<Entry>	v(static_cast<size_t>(h.entries));
+	if (!v.empty() && !src.read(reinterpret_cast<char*>(&v[0]), v.size() * sizeof(Entry)))
+		return false;
+
+	for (size_t i = 0; i < v.size(); i++)
+		if (v[i].offset >= h.sourceSize || (i > 0 && v[i].offset <= v[i - 1].offset))
+			return false;
+
+	sourceName = filename;
+	sourceStamp = source;
+	indexStep = h.step;
+	rowCount = static_cast<size_t>(h.rows);
+	entries.swap(v);
+	return true;
+}
+
+bool TraceIndex::write() const
+{
+	const std::string	indexName = nameFor(sourceName.c_str());
+	const std::string	tempName = indexName + ".tmp";
+
+	IndexHeader	h;
+	::memset(&h, 0, sizeof(h));
+	::memcpy(h.magic, IndexMagic, sizeof(IndexMagic));
+	h.version = IndexVersion;
+	h.byteOrder = ByteOrderMark;
+	h.sourceSize = sourceStamp.size;
+	h.sourceMtime = sourceStamp.mtime;
+	h.sourceMtimeNanoseconds = sourceStamp.mtimeNanoseconds;
+	h.rows = rowCount;
+	h.entries = entries.size();
+	h.step = indexStep;
+
+	{
+		std::ofstream	dest(tempName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!dest.is_open())
+			return false;
+
+		dest.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		if (!entries.empty())
+			dest.write(reinterpret_cast<const char*>(&entries[0]), entries.size() * sizeof(Entry));
+
+		dest.close();
+		if (!dest) {
+			::remove(tempName.c_str());
+			return false;
+		}
+	}
+
+#ifdef	_MSC_VER
+	// rename() does not replace existing files there
+	::remove(indexName.c_str());
+#endif
+	if (0 != ::rename(tempName.c_str(), indexName.c_str())) {
+		::remove(tempName.c_str());
+		return false;
+	}
+	return true;
+}
+
+void TraceIndex::start(const char* filename, const TraceSourceStamp& stamp, unsigned step)
+{
+	sourceName = filename;
+	sourceStamp = stamp;
+	indexStep = step > 0 ? step : DefaultStep;
+	rowCount = 0;
+	entries.clear();
+}
+
+}
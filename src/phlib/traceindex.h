@@ -0,0 +1,92 @@
+/*
+ * traceindex.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Sparse index of data lines (lines having numbers) of a trace file, kept
+ * next to it as <filename>.phindex. Byte offset and text line number of
+ * every <step>-th data line are recorded, so reading may start near any
+ * data line. Index is valid while size and modification time of the file
+ * are the same as recorded. Files are in native byte order.
+ */
+
+#ifndef	__MD_TRACEINDEX_H_918273645509182736455091
+#define	__MD_TRACEINDEX_H_918273645509182736455091
+
+#include	<stddef.h>
+#include	<string>
+#include	<vector>
+#include	"tracecache.h"
+
+namespace phlib {
+
+class TraceIndex {
+public:
+	enum {DefaultStep = 1024};
+
+	struct Entry {
+		unsigned long long	offset;	// of line start
+		unsigned long long	line;	// number of non-empty lines before
+	};
+
+	inline TraceIndex() : indexStep(DefaultStep), rowCount(0) {}
+
+	static std::string nameFor(const char* filename);
+
+	// loads index of <filename>, returns false if index is missing,
+	// damaged or built from another version of the file
+	bool open(const char* filename);
+	// file is written under temporary name and renamed then
+	bool write() const;
+
+	// starts building index of <filename> which has version <stamp>
+	void start(const char* filename, const TraceSourceStamp& stamp, unsigned step);
+	// data lines must be added in file order
+	inline void addRow(unsigned long long offset, unsigned long long line) {
+		if (0 == rowCount++ % indexStep) {
+			const Entry	e = {offset, line};
+			entries.push_back(e);
+		}
+	}
+
+	inline const std::string& source() const {
+		return sourceName;
+	}
+	inline const TraceSourceStamp& stamp() const {
+		return sourceStamp;
+	}
+	inline unsigned step() const {
+		return indexStep;
+	}
+	inline size_t rows() const {
+		return rowCount;
+	}
+
+	// the nearest recorded data line at or before data line <row>
+	inline const Entry& entry(size_t row) const {
+		return entries[row / indexStep];
+	}
+	inline size_t entryRow(size_t row) const {
+		return row / indexStep * indexStep;
+	}
+
+private:
+	std::string	sourceName;
+	TraceSourceStamp	sourceStamp;
+	unsigned	indexStep;
+	size_t	rowCount;
+	std::vector<Entry>	entries;
+};
+
+}
+
+#endif	//	__MD_TRACEINDEX_H_918273645509182736455091
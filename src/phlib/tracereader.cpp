@@ -12,26 +12,503 @@
  */
 
 #include  "tracereader.h"
+#include  "numparse.h"
+#include  "thread.h"
+#include  "compression.h"
+#include  "namedexception.h"
+#include  "tracebinary.h"
+#include  "tracesegments.h"
 #include  <fstream>
 #include  <stdio.h>
 #include  <stdlib.h>
 #include  <string.h>
-#ifndef	_MSC_VER
-#include  <ext/stdio_filebuf.h>
-#endif
 #include  <errno.h>
+#include  <ctype.h>
 #include <memory>
+#include <sstream>
+#include <list>
+#include <limits.h>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#if defined(_MSC_VER)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace phlib {
 
 #define	STDIN_FILENAME	((const char*) "-")
 
+// returns end of number or <begin> if token is not a number
+// character at <end> must be a separator or a line feed
+static inline const char* parseNumber(const char* begin, const char* end, double& value)
+{
+	const char*	p = begin;
+
+	while (p != end && ::isspace(static_cast<unsigned char>(*p)))
+		p++;
+
+	const char*	p1 = parseDouble(p, end, value);
+	return p1 > p ? p1 : begin;
+}
+
+// splits line into tab separated fields and passes them to <handler>
+// fields not selected by handler are skipped without parsing
+// empty lines are skipped
+template <class Handler>
+static inline void scanLine(const char* p, const char* end, Handler& handler)
+{
+	// skip starting spaces
+	for (; p != end && ::isspace(static_cast<unsigned char>(*p)); p++);
+	if (p == end)
+		return;
+
+	bool	is_comment = false;
+	// check where line is a comment
+	if ('#' == *p) {
+		// skip remaining spaces
+		for (p++; p != end && ::isspace(static_cast<unsigned char>(*p)); p++);
+		if (p == end)
+			return;
+		is_comment = true;
+	}
+
+	handler.startLine();
+	if (is_comment && !handler.wantsComments()) {
+		handler.finishLine();
+		return;
+	}
+
+	// no fields are selected after <limit>
+	const int	limit = handler.limit();
+	for (int index = 0; index < limit; index++) {
+		// fields are separated by one or more tabs
+		while (p != end && '\t' == *p)
+			p++;
+		if (p == end)
+			break;
+
+		const char*	q = static_cast<const char*>(::memchr(p, '\t', end - p));
+		if (!q)
+			q = end;
+
+		if (is_comment)
+			handler.comment(p, q, index);
+		else if (handler.selected(index)) {
+			double	f;
+			const char*	p1 = parseNumber(p, q, f);
+
+			if (p1 > p)
+				handler.number(index, f, p1 - p);
+			else
+				handler.text(p, q, index);
+		}
+
+		p = q;
+	}
+
+	handler.finishLine();
+}
+
+// passes fields straight to the reader
+// until titles are complete every field is examined, as any number ends titles
+class TraceReader::LineHandler {
+	TraceReader&	reader;
+	const ColumnSelection&	columns;
+
+public:
+	LineHandler(TraceReader& reader, const ColumnSelection& columns) :
+		reader(reader), columns(columns) {}
+
+	inline bool wantsComments() const {
+		return !reader.noTitles;
+	}
+	inline int limit() const {
+		return reader.noTitles ? columns.limit() : INT_MAX;
+	}
+	inline bool selected(int index) const {
+		return !reader.noTitles || columns.contains(index);
+	}
+
+	inline void startLine() {
+		reader.startLine();
+	}
+	inline void comment(const char* begin, const char* end, int index) {
+		reader.addTitle(begin, end, index);
+	}
+	inline void number(int index, double value, std::streamsize prec) {
+		if (!reader.noTitles)
+			reader.finishTitles();
+		if (columns.contains(index)) {
+			reader.updatePrecision(prec);
+			reader.handleNumber(index, value);
+		}
+	}
+	inline void text(const char* begin, const char* end, int index) {
+		if (selected(index))
+			reader.handleText(begin, end, index);
+	}
+	inline void finishLine() {
+		reader.finishLine();
+	}
+};
+
+// collects all columns to cache builder, titles go to the reader
+class TraceReader::CacheHandler {
+	TraceReader&	reader;
+	TraceCacheBuilder&	builder;
+
+public:
+	CacheHandler(TraceReader& reader, TraceCacheBuilder& builder) :
+		reader(reader), builder(builder) {}
+
+	inline bool wantsComments() const {
+		return !reader.noTitles;
+	}
+	inline int limit() const {
+		return INT_MAX;
+	}
+	inline bool selected(int) const {
+		return true;
+	}
+
+	inline void startLine() {
+		builder.startLine();
+	}
+	inline void comment(const char* begin, const char* end, int index) {
+		reader.addTitle(begin, end, index);
+	}
+	inline void number(int index, double value, std::streamsize prec) {
+		if (!reader.noTitles)
+			reader.finishTitles();
+		builder.addNumber(index, value, static_cast<int>(prec));
+	}
+	inline void text(const char* begin, const char* end, int index) {
+		if (!reader.noTitles)
+			reader.addTitle(begin, end, index);
+		else
+			builder.addText(index);
+	}
+	inline void finishLine() {
+		builder.finishLine();
+	}
+};
+
+// Chunk of data lines parsed by a worker thread.
+// Titles are complete at this point, so comments are of no interest and
+// text fields are kept as markers only. Parsed fields are replayed by the
+// reading thread afterwards.
+class TraceReader::ParseChunk : public Runnable {
+public:
+	enum {Text = 0, EndOfLine = -1};
+
+	struct Field {
+		double	value;
+		int	index;
+		int	precision;	// number of characters or Text or EndOfLine
+	};
+	typedef std::vector<Field>	FieldVector;
+
+	const char	*begin, *end;
+	const ColumnSelection*	columns;
+	Mutex*	mutex;
+	Condition*	parsed;
+	bool	done;
+	FieldVector	fields;
+
+	ParseChunk(const char* begin, const char* end, const ColumnSelection& columns, Mutex& mutex, Condition& parsed) :
+		begin(begin), end(end), columns(&columns), mutex(&mutex), parsed(&parsed), done(false) {}
+
+	inline bool wantsComments() const {
+		return false;
+	}
+	inline int limit() const {
+		return columns->limit();
+	}
+	inline bool selected(int index) const {
+		return columns->contains(index);
+	}
+
+	inline void startLine() {}
+	inline void comment(const char*, const char*, int) {}
+	inline void number(int index, double value, std::streamsize prec) {
+		add(index, value, static_cast<int>(prec));
+	}
+	inline void text(const char*, const char*, int index) {
+		add(index, 0.0, Text);
+	}
+	inline void finishLine() {
+		add(0, 0.0, EndOfLine);
+	}
+
+	virtual void run() {
+		// rough guess: a field takes about 10 characters
+		fields.reserve((end - begin) / 10);
+		for (const char* p = begin; p != end; ) {
+			const char*	eol = static_cast<const char*>(::memchr(p, '\n', end - p));
+			scanLine(p, eol, *this);
+			p = eol + 1;
+		}
+
+		ScopedLock	lock(*mutex);
+		done = true;
+		parsed->broadcast();
+	}
+
+private:
+	inline void add(int index, double value, int precision) {
+		const Field	f = {value, index, precision};
+		fields.push_back(f);
+	}
+};
+
+// position in a followed file
+struct TraceReader::FollowState {
+	enum {PollInterval = 100};	// milliseconds, when file changes are not watched
+
+	std::string	filename;
+	bool	started;	// file is read at least once
+	bool	changed;	// last call restarted file or read new lines
+	unsigned long long	offset;	// bytes read, including pending ones
+	unsigned long long	device, inode;	// identity of the file read
+	std::string	pending;	// incomplete last line
+	int	notifier, watch;	// inotify descriptors
+
+	FollowState(const char* filename) : filename(filename), started(false), changed(false),
+		offset(0), device(0), inode(0), notifier(-1), watch(-1) {}
+
+	~FollowState() {
+#ifdef	__linux__
+		if (notifier >= 0)
+			::close(notifier);
+#endif
+	}
+};
+
+// Looks through all fields of a line to find whether it is a data line,
+// collecting titles. When <deliver> is set selected fields are passed
+// to the reader too.
+class TraceReader::RowHandler {
+	TraceReader&	reader;
+	const ColumnSelection&	columns;
+	const bool	indexing;	// lines are only counted, state of the reader is kept
+	bool	titlesDone;	// noTitles of indexing handler
+
+	inline bool inTitles() const {
+		return indexing ? !titlesDone : !reader.noTitles;
+	}
+
+public:
+	bool	deliver;
+	bool	found;	// line has numbers
+	int	lines;	// lines scanned by indexing handler
+
+	RowHandler(TraceReader& reader, const ColumnSelection& columns, bool indexing = false) :
+		reader(reader), columns(columns), indexing(indexing), titlesDone(false),
+		deliver(false), found(false), lines(0) {}
+
+	inline bool wantsComments() const {
+		return inTitles();
+	}
+	inline int limit() const {
+		return INT_MAX;
+	}
+	inline bool selected(int) const {
+		return true;
+	}
+
+	inline void startLine() {
+		found = false;
+		if (deliver)
+			reader.startLine();
+	}
+	inline void comment(const char* begin, const char* end, int index) {
+		if (!indexing)
+			reader.addTitle(begin, end, index);
+	}
+	inline void number(int index, double value, std::streamsize prec) {
+		if (indexing)
+			titlesDone = true;
+		else if (!reader.noTitles)
+			reader.finishTitles();
+		if (deliver && columns.contains(index)) {
+			reader.updatePrecision(prec);
+			reader.handleNumber(index, value);
+		}
+		found = true;
+	}
+	inline void text(const char* begin, const char* end, int index) {
+		if (inTitles()) {
+			if (!indexing)
+				reader.addTitle(begin, end, index);
+		}
+		else if (deliver && columns.contains(index))
+			reader.handleText(begin, end, index);
+	}
+	inline void finishLine() {
+		if (deliver)
+			reader.finishLine();
+		else if (indexing)
+			lines++;
+		else
+			reader.lineCounter++;
+	}
+};
+
+// Reads a file on a worker thread with settings of another reader,
+// recording handler calls together with the reader state seen by them.
+// Calls are replayed by that reader afterwards.
+class TraceReader::FileRecorder : public TraceReader, public Runnable {
+public:
+	enum {DataLine = -1};
+
+	struct Call {
+		int	index;	// column or DataLine
+		int	line, dataLine;	// lineCounter and dataLineCounter
+		bool	first, start;	// firstLine and newLine
+		size_t	offset, count;	// of values
+	};
+
+	const std::string	filename;
+	const ColumnSelection&	columns;
+	Mutex&	mutex;
+	Condition&	parsed;
+	bool	done;
+	bool	failed;
+	std::string	error;
+	std::vector<Call>	calls;
+	std::vector<double>	values;
+	std::ostringstream	precision;	// maximal precision of numbers
+
+	FileRecorder(const TraceReader& owner, const std::string& filename, const ColumnSelection& columns,
+			Mutex& mutex, Condition& parsed) :
+		filename(filename), columns(columns), mutex(mutex), parsed(parsed), done(false), failed(false) {
+		needDataLine = owner.needDataLine;
+		decompressionThread = owner.decompressionThread;
+		useCache = owner.useCache;
+		batchSize = owner.batchSize;
+		readAhead = owner.readAhead;
+
+		precision.precision(0);
+		controlledStream = &precision;
+	}
+
+	virtual void run() {
+		try {
+			read(filename.c_str(), columns);
+		}
+		catch (std::exception& e) {
+			failed = true;
+			error = e.what();
+		}
+		catch (...) {
+			failed = true;
+			error = "Unknown error while reading " + filename;
+		}
+
+		ScopedLock	lock(mutex);
+		done = true;
+		parsed.broadcast();
+	}
+
+	virtual void handle(int index, double value) {
+		record(index, &value, 1);
+	}
+	virtual void handle(float_vector& v) {
+		record(DataLine, v.empty() ? 0 : &v[0], v.size());
+	}
+	virtual void handle(int index, const double* values, size_t count) {
+		record(index, values, count);
+	}
+
+private:
+	void record(int index, const double* v, size_t count) {
+		const Call	c = {index, lineCounter, dataLineCounter, firstLine, newLine, values.size(), count};
+		calls.push_back(c);
+		values.insert(values.end(), v, v + count);
+	}
+};
+
+// reads a file with a reader of its own
+class TraceReader::FileTask : public Runnable {
+public:
+	TraceReader*	reader;
+	std::string	filename;
+	const ColumnSelection*	columns;
+	bool	failed;
+	std::string	error;
+
+	FileTask(TraceReader* reader, const std::string& filename, const ColumnSelection& columns) :
+		reader(reader), filename(filename), columns(&columns), failed(false) {}
+
+	virtual void run() {
+		try {
+			reader->read(filename.c_str(), *columns);
+		}
+		catch (std::exception& e) {
+			failed = true;
+			error = e.what();
+		}
+		catch (...) {
+			failed = true;
+			error = "Unknown error while reading " + filename;
+		}
+	}
+};
+
+///////////////////////////////////////////
+//
+// ColumnSelection members
+//
+///////////////////////////////////////////
+
+ColumnSelection::ColumnSelection(int index_begin, int index_end) : tail(INT_MAX)
+{
+	if (index_begin < 0)
+		index_begin = 0;
+
+	if (index_end < 0)
+		tail = index_begin;
+	else if (index_end > index_begin) {
+		mask.resize(index_end, false);
+		std::fill(mask.begin() + index_begin, mask.end(), true);
+	}
+}
+
+ColumnSelection::ColumnSelection(const std::vector<int>& columns) : tail(INT_MAX)
+{
+	for (std::vector<int>::const_iterator i = columns.begin(); i != columns.end(); i++)
+		add(*i);
+}
+
+void ColumnSelection::add(int index)
+{
+	if (index < 0 || index >= tail)
+		return;
+	if (static_cast<int>(mask.size()) <= index)
+		mask.resize(index + 1, false);
+	mask[index] = true;
+}
+
 ///////////////////////////////////////////
 //
 // TraceReader members
 //
 ///////////////////////////////////////////
 
+TraceReader::~TraceReader()
+{
+	delete follower;
+	delete rowIndex;
+}
+
 bool TraceReader::isZip(const char* filename)
 {
 	const char	*p = strrchr(filename, '.');
@@ -53,95 +530,128 @@ void TraceReader::read(int index_begin, int index_end)
   read(filenames, index_begin, index_end);
 }
 
-void TraceReader::read(std::istream& src, int index_begin, int index_end) {
-	static const char	sep[] = "\t";
-	std::auto_ptr<char>	buf(new char[BufferSize]);
-	char	*buf_start, *p, *p1;
-	int	index;
-	double	f;
-	bool  notitles = false, is_comment;
+void TraceReader::read(const ColumnSelection& columns)
+{
+  read(filenames, columns);
+}
+
+void TraceReader::read(std::istream& src, int index_begin, int index_end)
+{
+	read(src, ColumnSelection(index_begin, index_end));
+}
 
-	lineCounter = dataLineCounter = 0;
-	if (controlledStream)
-		maxPrecision = controlledStream->precision();
+void TraceReader::read(std::istream& src, const ColumnSelection& columns) {
+	unsigned long long	bytesRead = 0;
 
-	firstLine = true;
-	dataTitles.clear();
+	startParsing();
+	size_t	filled = readLines(src, 0, columns, bytesRead);
 
-	while (!src.eof()) {
-		src.getline(buf.get(), BufferSize);
+	if (filled > 0) {
+		// last line has no line feed
+		if (filled == streamBuffer.size())
+			streamBuffer.resize(filled + 1);
+		streamBuffer[filled++] = '\n';
+		parse(&streamBuffer[0], &streamBuffer[0] + filled, columns);
+	}
 
-		// skip starting spaces
-		for (buf_start = buf.get(); *buf_start && ::isspace(*buf_start); buf_start++);
-		if (!*buf_start)
-			continue;
+	finishReading();
+}
 
-		is_comment = false;
-		// check where line is a comment
-		if ('#' == *buf_start) {
-			// skip remaining spaces
-			for (buf_start++; *buf_start && ::isspace(*buf_start); buf_start++);
-			if (!*buf_start)
-				continue;
-			is_comment = true;
-		}
-
-		newLine = true;
-		for (p = ::strtok(buf_start, sep), index = 0; p; p = ::strtok(0, sep), index++) {
-			if (is_comment) {
-				if (!notitles)
-					addTitle(p, index);
-				continue;
-			}
+// reads <src> to the end and parses complete lines, <filled> bytes of
+// stream buffer are the start of the first line; returns number of bytes
+// of the last incomplete line left at the start of stream buffer
+size_t TraceReader::readLines(std::istream& src, size_t filled, const ColumnSelection& columns,
+		unsigned long long& bytesRead)
+{
+	if (streamBuffer.size() < BufferSize)
+		streamBuffer.resize(BufferSize);
 
-			errno = 0;
-			f = ::strtod(p, &p1);
+	typedef std::char_traits<char>	traits;
+	std::streambuf*	buf = src.rdbuf();
 
-			if (p1 > p) {
-				// string is a number
+	while (src) {
+		if (filled == streamBuffer.size())
+			streamBuffer.resize(streamBuffer.size() * 2);	// line is longer than buffer
 
-				if (controlledStream) {
-					// don't lose data precision!
-					register std::streamsize prec = p1 - p;
-					if (prec > maxPrecision)
-						controlledStream->precision(maxPrecision = prec);
-				}
+		// waits for any data, then takes only the data available, so lines
+		// of pipes and terminals are handled as soon as they arrive
+		if (!buf || traits::eq_int_type(buf->sgetc(), traits::eof())) {
+			src.setstate(std::ios_base::eofbit);
+			break;
+		}
 
-				if (!needDataLine) {
-				  if ((index >= index_begin || index_begin < 0) && (index < index_end || index_end < 0)) {
-	  					  handle(index, f);
-								newLine = false;
-							}
-				}
-				else {
-							if (newLine) {
-								if (dataLine.size() > 0) {
-									dataLine.reserve(dataLine.size());
-								}
-								dataLine.clear();
-								newLine = false;
-							}
-				  dataLine.push_back(f);
-				}
-			       notitles = true;
-			}
-			else if (!notitles) {
-				// string is not a number
-				addTitle(p, index);
+		const size_t	last = filled;
+		for (std::streamsize avail; filled < streamBuffer.size() && (avail = buf->in_avail()) > 0; )
+			filled += static_cast<size_t>(buf->sgetn(&streamBuffer[filled],
+				std::min<std::streamsize>(avail, streamBuffer.size() - filled)));
+
+		// unbuffered stream, e.g. std::cin synchronized with stdio
+		if (filled == last)
+			for (traits::int_type c; filled < streamBuffer.size()
+					&& !traits::eq_int_type(c = buf->sbumpc(), traits::eof()); ) {
+				streamBuffer[filled++] = traits::to_char_type(c);
+				if ('\n' == streamBuffer[filled - 1])
+					break;
 			}
-			else if (needDataLine)
-				dataLine.push_back(0.0);
+
+		bytesRead += filled - last;
+
+		// parse complete lines only, keep the rest for the next pass
+		// the rest never contains line feeds, so look at new data only
+		size_t	complete = filled;
+		while (complete > last && '\n' != streamBuffer[complete - 1])
+			complete--;
+
+		if (complete > last) {
+			parse(&streamBuffer[0], &streamBuffer[0] + complete, columns);
+			::memmove(&streamBuffer[0], &streamBuffer[0] + complete, filled - complete);
+			filled -= complete;
 		}
+	}
 
-		if (needDataLine && !newLine && dataLine.size()) {
-		  handle(dataLine);
-		  dataLineCounter++;
+	return filled;
+}
+
+void TraceReader::read(const MappedFile& src, int index_begin, int index_end)
+{
+	read(src, ColumnSelection(index_begin, index_end));
+}
+
+void TraceReader::read(const MappedFile& src, const ColumnSelection& columns)
+{
+	if (BinaryTraceScanner::isBinary(src.data(), src.size())) {
+		readBinary(src, columns);
+		return;
+	}
+
+	const char	*begin = src.data(), *end = begin + src.size();
+
+	startParsing();
+
+	// file data is parsed in place, except for the last line without line feed
+	const char*	complete = end;
+	while (complete != begin && '\n' != complete[-1])
+		complete--;
+
+	if (1 != parseThreads && !cacheBuilder && complete - begin >= 2 * ChunkSize) {
+		// titles are collected in file order until the first data line
+		while (begin != complete && !noTitles) {
+			const char*	eol = static_cast<const char*>(::memchr(begin, '\n', complete - begin));
+			parseLine(begin, eol, columns);
+			begin = eol + 1;
 		}
+		parseParallel(begin, complete, columns);
+	}
+	else
+		parse(begin, complete, columns);
 
-		lineCounter++;
-		if (!newLine)
-			firstLine = false;
+	if (complete != end) {
+		std::string	tail(complete, end);
+		tail += '\n';
+		parse(tail.data(), tail.data() + tail.size(), columns);
 	}
+
+	finishReading();
 }
 
 void TraceReader::read(const char* filename)
@@ -156,46 +666,250 @@ void TraceReader::read(const char* filename, int index)
 
 void TraceReader::read(const char* filename, int index_begin, int index_end)
 {
-	if (!isZip(filename)) {
-		if (0 == ::strcmp(STDIN_FILENAME, filename))
-			read(std::cin, index_begin, index_end);
-		else {
-			std::ifstream	src(filename);
-			if (!src.is_open())
-				return;
+	read(filename, ColumnSelection(index_begin, index_end));
+}
+
+void TraceReader::read(const char* filename, const ColumnSelection& columns)
+{
+	// binary files are not parsed, cache would not be faster
+	if (useCache && 0 != ::strcmp(STDIN_FILENAME, filename)
+			&& !BinaryTraceScanner::isBinaryFile(filename) && readCached(filename, columns))
+		return;
+
+	readSource(filename, columns);
+}
 
-			read(src, index_begin, index_end);
+// builds cache if necessary, returns false if there is no valid cache
+bool TraceReader::readCached(const char* filename, const ColumnSelection& columns)
+{
+	TraceCache	cache;
+
+	if (!cache.open(filename)) {
+		// stamp is taken before parsing, so changes made meanwhile invalidate cache
+		TraceSourceStamp	source;
+		if (!source.read(filename))
+			return false;
+
+		TraceCacheBuilder	builder;
+		cacheBuilder = &builder;
+		try {
+			readSource(filename, ColumnSelection());
+		}
+		catch (...) {
+			cacheBuilder = 0;
+			throw;
 		}
+		cacheBuilder = 0;
+
+		if (!builder.write(TraceCache::nameFor(filename).c_str(), dataTitles, source) || !cache.open(filename))
+			return false;
 	}
-	else {
-		std::string command("unzip -p ");
-		command += filename;
 
-		FILE*	p = 
-#ifdef	_MSC_VER
-			_popen(command.c_str(), "rt");
-#else	//	_MSC_VER
-			popen(command.c_str(), "r");
-#endif	//	_MSC_VER
+	replayCache(cache, columns);
+	return true;
+}
 
-		if (0 != p) {
+void TraceReader::replayCache(const TraceCache& cache, const ColumnSelection& columns)
+{
+	startParsing();
+	setTitles(cache.titles());
 
-#ifdef	_MSC_VER
-			std::filebuf	buffer(p);
-#else	//	_MSC_VER
-			__gnu_cxx::stdio_filebuf<char>	buffer(p, std::ios_base::in);
-#endif	//	_MSC_VER
+	std::vector<int>	selected;
+	std::vector<const double*>	values;
+	std::vector<const unsigned char*>	cells;
+	int	precision = 0;
+	for (int c = 0, n = std::min(cache.columns(), columns.limit()); c < n; c++)
+		if (columns.contains(c)) {
+			selected.push_back(c);
+			values.push_back(cache.column(c));
+			cells.push_back(cache.cells(c));
+			precision = std::max(precision, cache.precision(c));
+		}
 
-			std::istream	src(&buffer);
-			read(src, index_begin, index_end);
+	if (precision > 0)
+		updatePrecision(precision);
 
-#ifdef	_MSC_VER
-			_pclose(p);
-#else	//	_MSC_VER
-			pclose(p);
-#endif	//	_MSC_VER
+	const unsigned*	skipped = cache.skippedLines();
+	const size_t	rows = cache.rows();
+
+	if (batchSize && !needDataLine) {
+		// blocks are passed straight from the cache, column after column
+		for (size_t k = 0; k < selected.size(); k++)
+			for (size_t r = 0; r < rows; ) {
+				while (r < rows && TraceCache::cellNumber != cells[k][r])
+					r++;
+
+				const size_t	first = r;
+				while (r < rows && TraceCache::cellNumber == cells[k][r] && r - first < batchSize)
+					r++;
+
+				if (r > first) {
+					handle(selected[k], values[k] + first, r - first);
+					firstLine = false;
+				}
+			}
+
+		for (size_t r = 0; r < rows; r++)
+			lineCounter += skipped[r] + 1;
+		lineCounter += static_cast<int>(cache.trailingLines());
+		return;
+	}
+
+	for (size_t r = 0; r < rows; r++) {
+		lineCounter += skipped[r];
+
+		startLine();
+		for (size_t k = 0; k < selected.size(); k++) {
+			if (TraceCache::cellNumber == cells[k][r])
+				handleNumber(selected[k], values[k][r]);
+			else if (TraceCache::cellText == cells[k][r])
+				handleText(0, 0, selected[k]);
+		}
+		finishLine();
+	}
+
+	lineCounter += static_cast<int>(cache.trailingLines());
+}
+
+void TraceReader::readBinary(const MappedFile& src, const ColumnSelection& columns)
+{
+	startParsing();
+
+	BinaryTraceScanner	scanner(src.data(), src.data() + src.size());
+	std::vector<int>	selected;
+
+	for (BinaryTraceScanner::Record r; BinaryTraceScanner::recordEnd != (r = scanner.next()); ) {
+		if (BinaryTraceScanner::recordTitles == r) {
+			// titles following data lines are ignored as in text files
+			if (!noTitles)
+				setTitles(scanner.titles());
+			lineCounter++;
+			continue;
+		}
+
+		if (!noTitles)
+			finishTitles();
+
+		const size_t	rows = scanner.rows(), width = scanner.columns();
+		const double*	values = scanner.values();
+
+		selected.clear();
+		for (int c = 0, n = std::min(static_cast<int>(width), columns.limit()); c < n; c++)
+			if (columns.contains(c))
+				selected.push_back(c);
+
+		for (size_t i = 0; i < rows; i++, values += width) {
+			startLine();
+			for (std::vector<int>::const_iterator c = selected.begin(); c != selected.end(); c++)
+				handleNumber(*c, values[*c]);
+			finishLine();
+		}
+	}
+
+	finishReading();
+
+	if (scanner.damaged())
+		throw NamedException("Binary trace file is damaged or truncated");
+}
+
+// readRows() of binary file, records preceding row <first> are skipped whole
+size_t TraceReader::readBinaryRows(const MappedFile& src, size_t first, size_t count, const ColumnSelection& columns)
+{
+	startParsing();
+
+	BinaryTraceScanner	scanner(src.data(), src.data() + src.size());
+	std::vector<int>	selected;
+	size_t	row = 0, passed = 0;
+
+	for (BinaryTraceScanner::Record r; BinaryTraceScanner::recordEnd != (r = scanner.next()); ) {
+		if (BinaryTraceScanner::recordTitles == r) {
+			if (!noTitles)
+				setTitles(scanner.titles());
+			lineCounter++;
+			continue;
+		}
+
+		if (!noTitles)
+			finishTitles();
+
+		const size_t	rows = scanner.rows(), width = scanner.columns();
+		const size_t	skipped = std::min(rows, first > row ? first - row : 0);
+		const double*	values = scanner.values() + skipped * width;
+
+		selected.clear();
+		for (int c = 0, n = std::min(static_cast<int>(width), columns.limit()); c < n; c++)
+			if (columns.contains(c))
+				selected.push_back(c);
+
+		lineCounter += static_cast<int>(skipped);
+		dataLineCounter = static_cast<int>(row + skipped);
+		for (size_t i = skipped; i < rows && passed < count; i++, passed++, values += width) {
+			startLine();
+			for (std::vector<int>::const_iterator c = selected.begin(); c != selected.end(); c++)
+				handleNumber(*c, values[*c]);
+			finishLine();
 		}
+
+		row += rows;
+		if (passed == count)
+			break;
 	}
+
+	finishReading();
+
+	if (scanner.damaged())
+		throw NamedException("Binary trace file is damaged or truncated");
+	return passed;
+}
+
+void TraceReader::readSource(const char* filename, const ColumnSelection& columns)
+{
+	Compression	format = isZip(filename) ? compressionZip : compressionByName(filename);
+
+	if (compressionNone == format) {
+		if (0 == ::strcmp(STDIN_FILENAME, filename)) {
+			readStandardInput(columns);
+			return;
+		}
+
+		MappedFile	map;
+		if (map.open(filename)) {
+			read(map, columns);
+			return;
+		}
+
+		// not a regular file, e.g. named pipe
+		if (!readAhead) {
+			std::ifstream	src(filename);
+			if (src.is_open())
+				read(src, columns);
+			return;
+		}
+	}
+
+	// compressed data or data read ahead
+	DecompressingBuf	buffer;
+	if (!buffer.open(filename, format, compressionNone == format || decompressionThread))
+		return;
+
+	std::istream	src(&buffer);
+	read(src, columns);
+
+	if (compressionNone != format && buffer.failed())
+		throw NamedException("Compressed file is damaged or truncated");
+}
+
+void TraceReader::readStandardInput(const ColumnSelection& columns)
+{
+	if (readAhead) {
+		DecompressingBuf	buffer;
+		buffer.open(0, true);
+
+		std::istream	src(&buffer);
+		read(src, columns);
+	}
+	else
+		read(std::cin, columns);
 }
 
 void TraceReader::read(const std::vector<const char*>& filenames, int index)
@@ -210,25 +924,697 @@ void TraceReader::read(const std::vector<std::string>& filenames, int index)
 }
 
 void TraceReader::read(const std::vector<std::string>& filenames, int index_begin, int index_end)
+{
+	read(filenames, ColumnSelection(index_begin, index_end));
+}
+
+void TraceReader::read(const std::vector<std::string>& filenames, const ColumnSelection& columns)
 {
 	if (0 == filenames.size() || (1 == filenames.size() && 0 == ::strcmp(STDIN_FILENAME, filenames.front().c_str()))) {
-		  read(std::cin, index_begin, index_end);
+		  readStandardInput(columns);
 	}
+	else if (1 != fileThreads && filenames.size() > 1)
+		readFilesParallel(filenames, columns);
 	else {
 	  for (std::vector<std::string>::const_iterator i = filenames.begin(); i != filenames.end(); i++)
-		  read(i->c_str(), index_begin, index_end);
+		  read(i->c_str(), columns);
 	}
 }
 
-void TraceReader::addTitle(const char* title, int index)
+void TraceReader::setThreads(unsigned threads, bool ordered)
 {
-	if (*title) {
-		while (static_cast<int>(dataTitles.size()) <= index)
-			dataTitles.push_back("");
-		if (dataTitles[index].size() > 0)
-			dataTitles[index] += " ";
-		dataTitles[index] += title;
+	parseThreads = threads;
+	parseOrdered = ordered;
+}
+
+void TraceReader::setFileThreads(unsigned threads)
+{
+	fileThreads = threads;
+}
+
+void TraceReader::readConcurrently(const std::vector<TraceReader*>& readers,
+		const std::vector<std::string>& filenames, const ColumnSelection& columns, unsigned threads)
+{
+	const size_t	n = std::min(readers.size(), filenames.size());
+	std::vector<FileTask>	tasks;
+	tasks.reserve(n);	// tasks must not move while the pool runs
+
+	{
+		ThreadPool	pool(threads);
+		for (size_t i = 0; i < n; i++) {
+			tasks.push_back(FileTask(readers[i], filenames[i], columns));
+			pool.submit(tasks.back());
+		}
+		pool.wait();
 	}
+
+	for (std::vector<FileTask>::const_iterator i = tasks.begin(); i != tasks.end(); i++)
+		if (i->failed)
+			throw NamedException(i->error.c_str());
+}
+
+void TraceReader::setDecompressionThread(bool enable)
+{
+	decompressionThread = enable;
+}
+
+void TraceReader::setBatchSize(size_t size)
+{
+	batchSize = size;
+}
+
+void TraceReader::setReadAhead(bool enable)
+{
+	readAhead = enable;
+}
+
+void TraceReader::setCache(bool enable)
+{
+	useCache = enable;
+}
+
+// milliseconds from an arbitrary point
+static long long monotonicTime()
+{
+#ifdef	_MSC_VER
+	return ::GetTickCount64();
+#else
+	struct timespec	t;
+	::clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000LL + t.tv_nsec / 1000000;
+#endif
+}
+
+bool TraceReader::readAppended(const char* filename, const ColumnSelection& columns)
+{
+	if (!follower || follower->filename != filename) {
+		delete follower;
+		follower = 0;	// in case of allocation failure
+		follower = new FollowState(filename);
+	}
+
+	FollowState&	f = *follower;
+	f.changed = false;
+
+	struct stat	st;
+	if (0 != ::stat(filename, &st))
+		return false;
+
+	const unsigned long long	size = st.st_size;
+	if (!f.started || f.device != static_cast<unsigned long long>(st.st_dev)
+			|| f.inode != static_cast<unsigned long long>(st.st_ino) || size < f.offset) {
+		// first read, or file is rotated or truncated
+		f.started = true;
+		f.changed = true;
+		f.offset = 0;
+		f.device = st.st_dev;
+		f.inode = st.st_ino;
+		f.pending.clear();
+		startParsing();
+	}
+
+	if (size == f.offset)
+		return true;
+
+	std::ifstream	src(filename, std::ios_base::in | std::ios_base::binary);
+	if (!src.is_open())
+		return false;
+	if (f.offset > 0 && !src.seekg(static_cast<std::streamoff>(f.offset)))
+		return false;
+
+	// incomplete line of the previous call goes first
+	if (streamBuffer.size() < std::max<size_t>(BufferSize, f.pending.size() + 1))
+		streamBuffer.resize(std::max<size_t>(BufferSize, 2 * f.pending.size()));
+	std::copy(f.pending.begin(), f.pending.end(), streamBuffer.begin());
+
+	const int	lines = lineCounter;
+	unsigned long long	bytesRead = 0;
+	const size_t	filled = readLines(src, f.pending.size(), columns, bytesRead);
+
+	// the last line may be still being written, it is parsed when complete
+	f.pending.assign(streamBuffer.begin(), streamBuffer.begin() + filled);
+	f.offset += bytesRead;
+	f.changed = f.changed || lines != lineCounter;
+
+	finishReading();
+	return true;
+}
+
+bool TraceReader::follow(const char* filename, int timeout, const ColumnSelection& columns)
+{
+	long long	remaining = timeout;
+
+	for (;;) {
+		if (readAppended(filename, columns) && follower->changed)
+			return true;
+		if (0 == remaining)
+			return false;
+
+		const int	wait = remaining < 0 || remaining > INT_MAX ? -1 : static_cast<int>(remaining);
+		const long long	started = monotonicTime();
+		waitForChange(filename, wait);
+
+		if (remaining > 0)
+			remaining = std::max(0LL, remaining - (monotonicTime() - started));
+	}
+}
+
+void TraceReader::stopFollowing()
+{
+	delete follower;
+	follower = 0;
+}
+
+// returns after <timeout> milliseconds (negative means forever) or when
+// followed file is likely to be changed, spurious wakeups are possible
+void TraceReader::waitForChange(const char* filename, int timeout)
+{
+#ifdef	__linux__
+	FollowState&	f = *follower;
+	if (f.notifier < 0)
+		f.notifier = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	// file watched before may be replaced since
+	const int	watch = f.notifier < 0 ? -1 : ::inotify_add_watch(f.notifier, filename,
+			IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF);
+	if (watch >= 0) {
+		if (f.watch >= 0 && f.watch != watch)
+			::inotify_rm_watch(f.notifier, f.watch);
+		f.watch = watch;
+
+		struct pollfd	p = {f.notifier, POLLIN, 0};
+		if (::poll(&p, 1, timeout) > 0) {
+			char	events[4096];
+			while (::read(f.notifier, events, sizeof(events)) > 0);
+		}
+		return;
+	}
+#endif	//	__linux__
+
+	// file does not exist yet or changes cannot be watched
+	const int	interval = timeout < 0 ? FollowState::PollInterval
+		: std::min<int>(timeout, FollowState::PollInterval);
+#ifdef	_MSC_VER
+	::Sleep(interval);
+#else
+	::usleep(interval * 1000);
+#endif
+}
+
+void TraceReader::readSegments(const char* filename, const ColumnSelection& columns)
+{
+	const std::vector<std::string>	segments = traceSegments(filename);
+
+	for (std::vector<std::string>::const_iterator i = segments.begin(); i != segments.end(); i++) {
+		continuing = i != segments.begin();
+		try {
+			read(i->c_str(), columns);
+		}
+		catch (...) {
+			continuing = false;
+			throw;
+		}
+	}
+	continuing = false;
+}
+
+size_t TraceReader::readRows(const char* filename, size_t first, size_t count, const ColumnSelection& columns)
+{
+	MappedFile	map;
+	if (!map.open(filename, false))
+		return 0;
+	// binary files have no index, rows are counted by records
+	if (BinaryTraceScanner::isBinary(map.data(), map.size()))
+		return readBinaryRows(map, first, count, columns);
+	if (!prepareIndex(filename, map))
+		return 0;
+
+	// index not matching the file, e.g. damaged one, is rebuilt once
+	size_t	passed;
+	if (!readIndexedRows(map, first, count, columns, passed)
+			&& (!prepareIndex(filename, map, true) || !readIndexedRows(map, first, count, columns, passed)))
+		return 0;
+	return passed;
+}
+
+// readRows() by current index, returns false if the index does not match <map>
+bool TraceReader::readIndexedRows(const MappedFile& map, size_t first, size_t count,
+		const ColumnSelection& columns, size_t& passed)
+{
+	const char	*begin = map.data(), *end = begin + map.size();
+	RowHandler	handler(*this, columns);
+	passed = 0;
+
+	if (rowIndex->rows() > 0 && rowIndex->entry(0).offset > map.size())
+		return false;
+
+	// titles are in lines preceding the first data line
+	// and in text fields preceding the first number
+	startParsing();
+	const char*	p = begin;
+	const char*	data = rowIndex->rows() > 0 ? begin + rowIndex->entry(0).offset : end;
+	while (p != data)
+		scanRow(p, data, handler);
+
+	if (first >= rowIndex->rows()) {
+		finishReading();
+		return true;
+	}
+	if (first > 0)
+		scanRow(p, end, handler);
+
+	// skip lines from the nearest indexed data line
+	const TraceIndex::Entry&	e = rowIndex->entry(first);
+	if (e.offset > map.size()) {
+		finishReading();
+		return false;
+	}
+	p = begin + e.offset;
+	lineCounter = static_cast<int>(e.line);
+	size_t	row = rowIndex->entryRow(first);
+	while (row < first && p != end)
+		if (scanRow(p, end, handler))
+			row++;
+	if (row < first) {
+		finishReading();
+		return false;
+	}
+
+	dataLineCounter = static_cast<int>(first);
+	handler.deliver = true;
+
+	while (passed < count && p != end)
+		if (scanRow(p, end, handler))
+			passed++;
+
+	finishReading();
+	return true;
+}
+
+size_t TraceReader::countRows(const char* filename)
+{
+	MappedFile	map;
+	if (!map.open(filename, false))
+		return 0;
+
+	if (BinaryTraceScanner::isBinary(map.data(), map.size())) {
+		BinaryTraceScanner	scanner(map.data(), map.data() + map.size());
+		size_t	rows = 0;
+		for (BinaryTraceScanner::Record r; BinaryTraceScanner::recordEnd != (r = scanner.next()); )
+			if (BinaryTraceScanner::recordRows == r)
+				rows += scanner.rows();
+		return rows;
+	}
+
+	if (!prepareIndex(filename, map))
+		return 0;
+	return rowIndex->rows();
+}
+
+void TraceReader::setIndexStep(unsigned step)
+{
+	indexStep = step > 0 ? step : static_cast<unsigned>(TraceIndex::DefaultStep);
+}
+
+// makes index of <filename> mapped to <map> current, titles and counters
+// of the reader are not used; <rebuild> ignores index in memory and on disk
+bool TraceReader::prepareIndex(const char* filename, const MappedFile& map, bool rebuild)
+{
+	TraceSourceStamp	stamp;
+	if (!stamp.read(filename) || stamp.size != map.size())
+		return false;
+
+	if (!rebuild && rowIndex && rowIndex->source() == filename && rowIndex->stamp() == stamp
+			&& rowIndex->step() == indexStep)
+		return true;
+
+	if (!rowIndex)
+		rowIndex = new TraceIndex();
+	if (!rebuild && rowIndex->open(filename) && rowIndex->step() == indexStep)
+		return true;
+
+	rowIndex->start(filename, stamp, indexStep);
+
+	const ColumnSelection	none(0, 0);
+	RowHandler	handler(*this, none, true);
+	const char	*begin = map.data(), *end = begin + map.size();
+	for (const char* p = begin; p != end; ) {
+		const char*	line = p;
+		const int	lineNumber = handler.lines;
+		if (scanRow(p, end, handler))
+			rowIndex->addRow(line - begin, lineNumber);
+	}
+
+	rowIndex->write();
+	return true;
+}
+
+// parses line starting at <p> and moves <p> to the next line,
+// returns true if the line has numbers
+bool TraceReader::scanRow(const char*& p, const char* end, RowHandler& handler)
+{
+	handler.found = false;
+
+	const char*	eol = static_cast<const char*>(::memchr(p, '\n', end - p));
+	if (eol) {
+		scanLine(p, eol, handler);
+		p = eol + 1;
+	}
+	else {
+		// last line has no line feed
+		std::string	tail(p, end);
+		tail += '\n';
+		scanLine(tail.data(), tail.data() + tail.size() - 1, handler);
+		p = end;
+	}
+
+	return handler.found;
+}
+
+void TraceReader::startParsing()
+{
+	if (!continuing) {
+		lineCounter = dataLineCounter = 0;
+		if (controlledStream)
+			maxPrecision = controlledStream->precision();
+		firstLine = true;
+	}
+
+	noTitles = false;
+	titleColumns = 0;
+	blocks.clear();
+}
+
+// parse sequence of lines, the last one must end with line feed
+void TraceReader::parse(const char* begin, const char* end, const ColumnSelection& columns)
+{
+	while (begin != end) {
+		const char*	eol = static_cast<const char*>(::memchr(begin, '\n', end - begin));
+		parseLine(begin, eol, columns);
+		begin = eol + 1;
+	}
+}
+
+// data lines only, titles must be complete
+void TraceReader::parseParallel(const char* begin, const char* end, const ColumnSelection& columns)
+{
+	typedef std::list<ParseChunk>	ChunkList;
+
+	Mutex	mutex;
+	Condition	parsed;
+	ChunkList	chunks;	// must outlive the pool
+	ThreadPool	pool(parseThreads);
+
+	// limit memory held by parsed but not yet delivered chunks
+	const size_t	window = 2 * pool.size() + 1;
+	size_t	inProgress = 0;
+
+	while (begin != end || inProgress > 0) {
+		while (begin != end && inProgress < window) {
+			const char*	last = end;
+			if (end - begin > ChunkSize)
+				last = static_cast<const char*>(::memchr(begin + ChunkSize - 1, '\n', end - begin - ChunkSize + 1)) + 1;
+
+			chunks.push_back(ParseChunk(begin, last, columns, mutex, parsed));
+			inProgress++;
+			pool.submit(chunks.back());
+			begin = last;
+		}
+
+		ChunkList::iterator	ready = chunks.end();
+		{
+			ScopedLock	lock(mutex);
+			for (;;) {
+				if (parseOrdered) {
+					if (chunks.front().done)
+						ready = chunks.begin();
+				}
+				else {
+					for (ChunkList::iterator i = chunks.begin(); i != chunks.end(); i++)
+						if (i->done) {
+							ready = i;
+							break;
+						}
+				}
+
+				if (ready != chunks.end())
+					break;
+				parsed.wait(mutex);
+			}
+		}
+
+		replay(*ready);
+		chunks.erase(ready);
+		inProgress--;
+	}
+}
+
+void TraceReader::readFilesParallel(const std::vector<std::string>& filenames, const ColumnSelection& columns)
+{
+	struct FileList : public std::list<FileRecorder*> {
+		~FileList() {
+			for (iterator i = begin(); i != end(); i++)
+				delete *i;
+		}
+	};
+
+	Mutex	mutex;
+	Condition	parsed;
+	FileList	files;	// must outlive the pool
+	ThreadPool	pool(fileThreads);
+
+	// limit memory held by read but not yet handled files
+	const size_t	window = pool.size() + 1;
+	std::vector<std::string>::const_iterator	next = filenames.begin();
+
+	while (next != filenames.end() || !files.empty()) {
+		while (next != filenames.end() && files.size() < window) {
+			files.push_back(0);
+			files.back() = new FileRecorder(*this, *next++, columns, mutex, parsed);
+			pool.submit(*files.back());
+		}
+
+		{
+			ScopedLock	lock(mutex);
+			while (!files.front()->done)
+				parsed.wait(mutex);
+		}
+
+		std::auto_ptr<FileRecorder>	file(files.front());
+		files.pop_front();
+		replay(*file);
+	}
+}
+
+// handler calls are made in the same state as when file is read directly
+void TraceReader::replay(const FileRecorder& file)
+{
+	// titles are complete before the first call
+	startParsing();
+	setTitles(file.dataTitles);
+	if (file.maxPrecision > 0)
+		updatePrecision(file.maxPrecision);
+
+	for (std::vector<FileRecorder::Call>::const_iterator i = file.calls.begin(); i != file.calls.end(); i++) {
+		lineCounter = i->line;
+		dataLineCounter = i->dataLine;
+		firstLine = i->first;
+		newLine = i->start;
+
+		const double*	values = file.values.empty() ? 0 : &file.values[i->offset];
+		if (FileRecorder::DataLine == i->index) {
+			dataLine.assign(values, values + i->count);
+			handle(dataLine);
+		}
+		else if (batchSize)
+			handle(i->index, values, i->count);
+		else
+			handle(i->index, *values);
+	}
+
+	lineCounter = file.lineCounter;
+	dataLineCounter = file.dataLineCounter;
+	firstLine = file.firstLine;
+	newLine = file.newLine;
+	noTitles = file.noTitles;
+
+	if (file.failed)
+		throw NamedException(file.error.c_str());
+}
+
+void TraceReader::parseLine(const char* begin, const char* end, const ColumnSelection& columns)
+{
+	if (cacheBuilder) {
+		CacheHandler	handler(*this, *cacheBuilder);
+		scanLine(begin, end, handler);
+	}
+	else {
+		LineHandler	handler(*this, columns);
+		scanLine(begin, end, handler);
+	}
+}
+
+void TraceReader::replay(const ParseChunk& chunk)
+{
+	bool	lineStart = true;
+
+	for (ParseChunk::FieldVector::const_iterator i = chunk.fields.begin(); i != chunk.fields.end(); i++) {
+		if (lineStart) {
+			startLine();
+			lineStart = false;
+		}
+
+		if (ParseChunk::EndOfLine == i->precision) {
+			finishLine();
+			lineStart = true;
+		}
+		else if (ParseChunk::Text == i->precision)
+			handleText(0, 0, i->index);
+		else {
+			updatePrecision(i->precision);
+			handleNumber(i->index, i->value);
+		}
+	}
+}
+
+void TraceReader::updatePrecision(std::streamsize prec)
+{
+	// don't lose data precision!
+	if (controlledStream && prec > maxPrecision)
+		controlledStream->precision(maxPrecision = prec);
+}
+
+void TraceReader::startLine()
+{
+	newLine = true;
+
+	// text fields preceding the first number keep their places
+	if (needDataLine)
+		dataLine.clear();
+}
+
+void TraceReader::handleNumber(int index, double f)
+{
+	if (!needDataLine) {
+		if (batchSize) {
+			if (static_cast<int>(blocks.size()) <= index)
+				blocks.resize(index + 1);
+
+			float_vector&	block = blocks[index];
+			block.push_back(f);
+			if (block.size() >= batchSize) {
+				handle(index, &block[0], block.size());
+				block.clear();
+			}
+		}
+		else
+			handle(index, f);
+	}
+	else
+		dataLine.push_back(f);
+	newLine = false;
+}
+
+// titles of files without data lines are complete at the end
+void TraceReader::finishReading()
+{
+	if (!noTitles)
+		commitTitles();
+	flushBlocks();
+}
+
+void TraceReader::flushBlocks()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+		if (!blocks[i].empty()) {
+			handle(static_cast<int>(i), &blocks[i][0], blocks[i].size());
+			blocks[i].clear();
+		}
+}
+
+void TraceReader::handle(int index, const double* values, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		handle(index, values[i]);
+}
+
+void TraceReader::handleText(const char* begin, const char* end, int index)
+{
+	if (!noTitles)
+		addTitle(begin, end, index);
+	else if (needDataLine)
+		dataLine.push_back(0.0);
+}
+
+void TraceReader::finishLine()
+{
+	if (needDataLine && !newLine && dataLine.size()) {
+		handle(dataLine);
+		dataLineCounter++;
+	}
+
+	lineCounter++;
+	if (!newLine)
+		firstLine = false;
+}
+
+void TraceReader::addTitle(const char* begin, const char* end, int index)
+{
+	if (begin != end) {
+		// buffers of previous titles are reused
+		if (titleColumns <= static_cast<size_t>(index)) {
+			if (titleParts.size() <= static_cast<size_t>(index))
+				titleParts.resize(index + 1);
+			for (size_t i = titleColumns; i <= static_cast<size_t>(index); i++)
+				titleParts[i].clear();
+			titleColumns = index + 1;
+		}
+
+		std::string&	title = titleParts[index];
+		if (!title.empty())
+			title += ' ';
+		title.append(begin, end);
+	}
+}
+
+// the first number is found
+void TraceReader::finishTitles()
+{
+	noTitles = true;
+	commitTitles();
+}
+
+// data titles are rebuilt only if new titles differ from them
+void TraceReader::commitTitles()
+{
+	if (continuing && 0 == titleColumns) {
+		titlesUpdated = false;
+		return;
+	}
+
+	newTitleIds.resize(titleColumns);
+	for (size_t i = 0; i < titleColumns; i++)
+		newTitleIds[i] = titlePool.intern(titleParts[i]);
+
+	titlesUpdated = newTitleIds != titleIds || dataTitles.size() != titleColumns;
+	if (titlesUpdated) {
+		titleIds.swap(newTitleIds);
+		dataTitles.resize(titleColumns);
+		for (size_t i = 0; i < titleColumns; i++)
+			dataTitles[i].assign(titlePool.data(titleIds[i]), titlePool.length(titleIds[i]));
+	}
+}
+
+// titles are known in advance
+void TraceReader::setTitles(const TitleVector& titles)
+{
+	titleColumns = titles.size();
+	if (titleParts.size() < titleColumns)
+		titleParts.resize(titleColumns);
+	for (size_t i = 0; i < titleColumns; i++)
+		titleParts[i] = titles[i];
+
+	finishTitles();
 }
 
 ///////////////////////////////////////////
@@ -242,4 +1628,51 @@ void MatrixReader::handle(float_vector& v)
 	matrix.add(v);
 }
 
+///////////////////////////////////////////
+//
+// ColumnReader members
+//
+///////////////////////////////////////////
+
+ColumnReader::~ColumnReader()
+{
+	clear();
+}
+
+void ColumnReader::clear()
+{
+	for (std::vector<column_buffer*>::iterator i = data.begin(); i != data.end(); i++)
+		delete *i;
+	data.clear();
+	rowCount = 0;
+}
+
+void ColumnReader::handle(float_vector& v)
+{
+	// new columns are empty in previous rows
+	while (data.size() < v.size()) {
+		data.push_back(0);
+		data.back() = new column_buffer;
+		data.back()->resize(rowCount);
+	}
+
+	for (size_t i = 0; i < v.size(); i++)
+		data[i]->push_back(v[i]);
+	for (size_t i = v.size(); i < data.size(); i++)
+		data[i]->push_back(0.0);
+
+	rowCount++;
+}
+
+///////////////////////////////////////////
+//
+// DenseMatrixReader members
+//
+///////////////////////////////////////////
+
+void DenseMatrixReader::handle(float_vector& v)
+{
+	matrix.add(v);
+}
+
 }
@@ -17,14 +17,48 @@
 #include  <vector>
 #include  <string>
 #include	<iostream>
+#include	<limits.h>
 #include  "floatvector.h"
 #include  "floatmatrix.h"
+#include  "densematrix.h"
+#include  "columnbuffer.h"
+#include  "mappedfile.h"
+#include  "tracecache.h"
+#include  "traceindex.h"
+#include  "stringpool.h"
 
 namespace phlib {
 
+// set of columns passed to TraceReader handlers, all columns by default
+class ColumnSelection {
+	std::vector<bool>	mask;
+	int	tail;	// columns starting from this one are all selected
+
+public:
+	inline ColumnSelection() : tail(0) {}
+
+	// columns in range [index_begin, index_end), negative bound means no bound
+	ColumnSelection(int index_begin, int index_end);
+	explicit ColumnSelection(const std::vector<int>& columns);
+
+	void add(int index);
+
+	inline bool contains(int index) const {
+		return index >= tail || (index < static_cast<int>(mask.size()) && mask[index]);
+	}
+
+	// columns starting from this one are never selected, INT_MAX if not limited
+	inline int limit() const {
+		return INT_MAX == tail ? static_cast<int>(mask.size()) : INT_MAX;
+	}
+};
+
 class TraceReader {
 protected:
-	enum {BufferSize = 1024 * 1024 * 10};
+	enum {
+		BufferSize = 1024 * 1024 * 10,
+		ChunkSize = 1024 * 1024 * 4	// piece of file parsed by one worker thread
+	};
 
 	typedef	std::vector<std::string>	TitleVector;
 
@@ -39,8 +73,12 @@ protected:
   std::vector<std::string>  filenames;
 
   inline TraceReader() : needDataLine(false), controlledStream(0), maxPrecision(-1),
-		  lineCounter(0), dataLineCounter(0), dataLine(0), newLine(false), firstLine(false) {}
-  virtual ~TraceReader(){}
+		  lineCounter(0), dataLineCounter(0), dataLine(0), newLine(false), firstLine(false),
+		  noTitles(false), parseThreads(1), parseOrdered(true), decompressionThread(false),
+		  useCache(false), cacheBuilder(0), batchSize(0), follower(0),
+		  rowIndex(0), indexStep(TraceIndex::DefaultStep), fileThreads(1),
+		  readAhead(false), titleColumns(0), titlesUpdated(false), continuing(false) {}
+  virtual ~TraceReader();
 
 	virtual bool isZip(const char* filename);
 
@@ -52,6 +90,7 @@ public:
 
 	// trace thread in range [index_begin, index_end)
 	void read(std::istream& src, int index_begin, int index_end);
+	void read(const MappedFile& src, int index_begin, int index_end);
 	void read(const char* filename);
 	void read(const char* filename, int index);
 	void read(const char* filename, int index_begin, int index_end);
@@ -59,15 +98,188 @@ public:
   void read(const std::vector<std::string>& filenames, int index);
 	void read(const std::vector<std::string>& filenames, int index_begin, int index_end);
 
+	// Only selected columns are passed to handlers, with needDataLine too:
+	// data line then holds selected columns in index order. Unselected
+	// fields of data lines are not parsed at all.
+	// Binary trace files (see tracebinary.h) are recognized among named and
+	// mapped regular files and read without parsing: titles come before the
+	// first data line, each row is a data line. Compression of the file,
+	// cache, follow mode and row access are for text files only.
+	void read(const ColumnSelection& columns);
+	void read(std::istream& src, const ColumnSelection& columns);
+	void read(const MappedFile& src, const ColumnSelection& columns);
+	void read(const char* filename, const ColumnSelection& columns);
+	void read(const std::vector<std::string>& filenames, const ColumnSelection& columns);
+
   virtual void handle(int index, double value) {};
   virtual void handle(float_vector&) {};
 
+	// Block of consecutive numbers of column <index>, used instead of
+	// handle(int, double) when batch size is set. Numbers of a column come
+	// in file order, but blocks of different columns may come in any order
+	// and line boundaries are not reported. Default implementation passes
+	// numbers to handle(int, double) one by one.
+	virtual void handle(int index, const double* values, size_t count);
+
+	// numbers are passed in blocks of up to <size> values per column,
+	// 0 means one by one; data line mode is not affected
+	void setBatchSize(size_t size);
+
+	// Regular files are split into line-aligned chunks parsed by <threads>
+	// worker threads, 0 means "as many as CPU cores". Handlers are still
+	// called from the reading thread, one at a time. When <ordered> is false
+	// chunks are delivered as soon as they are parsed, so lines of different
+	// chunks may come out of file order.
+	void setThreads(unsigned threads, bool ordered = true);
+
+	// Files of read(filenames, ...) are read by <threads> worker threads,
+	// each file with its own parser state, 0 means "as many as CPU cores".
+	// Handlers are called from the reading thread in file order, with the
+	// same titles and counters as when files are read one by one. Files read
+	// ahead are held in memory until handled.
+	void setFileThreads(unsigned threads);
+
+	// Reads file <filenames[i]> with <readers[i]>, up to <threads> files at
+	// once, 0 means "as many as CPU cores". Handlers of different readers are
+	// called concurrently from worker threads. The first exception thrown by
+	// a reader is rethrown after all files are read.
+	static void readConcurrently(const std::vector<TraceReader*>& readers,
+			const std::vector<std::string>& filenames, const ColumnSelection& columns,
+			unsigned threads = 0);
+
+	// Compressed files (.zip, .gz, .zst) are decompressed on a separate
+	// thread while the data is parsed. Damaged compressed files are
+	// reported with NamedException after all readable lines are handled.
+	void setDecompressionThread(bool enable);
+
+	// Standard input and named files that cannot be mapped, e.g. pipes, are
+	// read on a separate thread into a ring of large buffers ahead of the
+	// parser, so waiting for data overlaps with parsing. Standard input must
+	// not be read by other means meanwhile.
+	void setReadAhead(bool enable);
+
+	// Named files are parsed once into binary columnar cache <filename>.phcache
+	// (see tracecache.h), later reads take data from the cache while the file
+	// stays unchanged. If cache cannot be written the file is parsed as usual.
+	void setCache(bool enable);
+
+	// Follow mode for files growing while they are read, e.g. written by
+	// TraceStream in append mode. The first call reads the whole file, next
+	// calls pass only complete lines appended since the previous call, with
+	// titles and line counters kept. A file that is truncated or replaced is
+	// read from the beginning again. Compression and cache are not used in
+	// this mode. Returns false if the file cannot be read.
+	bool readAppended(const char* filename, const ColumnSelection& columns = ColumnSelection());
+
+	// Waits up to <timeout> milliseconds (negative means forever) until
+	// the file grows, then reads appended lines as readAppended() does.
+	// Changes are watched with inotify on Linux and polled elsewhere.
+	// Returns false if no new lines are read.
+	bool follow(const char* filename, int timeout, const ColumnSelection& columns = ColumnSelection());
+
+	// forgets the followed file, next call reads it from the beginning
+	void stopFollowing();
+
+	// Reads file rotated by TraceWriter: its closed segments in order and
+	// the file itself (see tracesegments.h), as one trace. Line counters run
+	// through all segments; header lines at the beginning of each segment
+	// are taken as titles, not as data, and segments without them keep
+	// titles of the previous ones.
+	void readSegments(const char* filename, const ColumnSelection& columns = ColumnSelection());
+
+	// Passes <count> data lines (lines having numbers) of a regular file
+	// starting from data line <first>, counting from 0, together with titles
+	// of the file. Sparse index <filename>.phindex (see traceindex.h) is
+	// built on the first call and kept in memory, so the next calls seek
+	// to a line in constant time. Index is rebuilt when the file changes;
+	// if it cannot be written it is only kept in memory. Binary trace files
+	// are not indexed, records preceding <first> are skipped whole.
+	// Returns number of data lines passed.
+	size_t readRows(const char* filename, size_t first, size_t count,
+			const ColumnSelection& columns = ColumnSelection());
+
+	// Number of data lines of a regular file, index is built if necessary.
+	// Titles and line counters of the reader are left as they are.
+	size_t countRows(const char* filename);
+
+	// every <step>-th data line is indexed, affects indexes built later
+	void setIndexStep(unsigned step);
+
+	// Titles are interned in a pool shared by all reads of the reader, and
+	// data titles are rebuilt only when they differ from the previous ones.
+	// Returns false if the last read left titles as they were.
+	inline bool titlesChanged() const {
+		return titlesUpdated;
+	}
+
   int getNameCount() const {
     return filenames.size();
   }
 
 private:
-	void addTitle(const char* title, int index);
+	class LineHandler;
+	class CacheHandler;
+	class ParseChunk;
+	struct FollowState;
+	class RowHandler;
+	class FileRecorder;
+	class FileTask;
+
+	bool	noTitles;	// first line with numbers is found, titles are complete
+	std::vector<char>	streamBuffer;
+	unsigned	parseThreads;
+	bool	parseOrdered;
+	bool	decompressionThread;
+	bool	useCache;
+	TraceCacheBuilder*	cacheBuilder;	// data is collected to cache instead of handling
+	size_t	batchSize;
+	std::vector<float_vector>	blocks;	// numbers waiting to be passed, by column
+	FollowState*	follower;
+	TraceIndex*	rowIndex;	// index of the file read by readRows()
+	unsigned	indexStep;
+	unsigned	fileThreads;
+	bool	readAhead;
+	string_pool	titlePool;
+	std::vector<std::string>	titleParts;	// titles being parsed, by column
+	size_t	titleColumns;	// number of titleParts in use
+	std::vector<int>	titleIds, newTitleIds;	// numbers of data titles in titlePool
+	bool	titlesUpdated;
+	bool	continuing;	// next segment of a rotated file is read, counters are kept
+
+	TraceReader(const TraceReader&);
+	TraceReader& operator=(const TraceReader&);
+
+	void readSource(const char* filename, const ColumnSelection& columns);
+	void readStandardInput(const ColumnSelection& columns);
+	bool readCached(const char* filename, const ColumnSelection& columns);
+	void replayCache(const TraceCache& cache, const ColumnSelection& columns);
+	void readBinary(const MappedFile& src, const ColumnSelection& columns);
+	size_t readBinaryRows(const MappedFile& src, size_t first, size_t count, const ColumnSelection& columns);
+	void startParsing();
+	size_t readLines(std::istream& src, size_t filled, const ColumnSelection& columns,
+			unsigned long long& bytesRead);
+	void waitForChange(const char* filename, int timeout);
+	bool prepareIndex(const char* filename, const MappedFile& map, bool rebuild = false);
+	bool readIndexedRows(const MappedFile& map, size_t first, size_t count,
+			const ColumnSelection& columns, size_t& passed);
+	bool scanRow(const char*& p, const char* end, RowHandler& handler);
+	void parse(const char* begin, const char* end, const ColumnSelection& columns);
+	void parseParallel(const char* begin, const char* end, const ColumnSelection& columns);
+	void parseLine(const char* begin, const char* end, const ColumnSelection& columns);
+	void replay(const ParseChunk& chunk);
+	void readFilesParallel(const std::vector<std::string>& filenames, const ColumnSelection& columns);
+	void replay(const FileRecorder& file);
+	void updatePrecision(std::streamsize prec);
+	void startLine();
+	void handleNumber(int index, double value);
+	void flushBlocks();
+	void finishReading();
+	void handleText(const char* begin, const char* end, int index);
+	void finishLine();
+	void addTitle(const char* begin, const char* end, int index);
+	void finishTitles();
+	void commitTitles();
+	void setTitles(const TitleVector& titles);
 };
 
 class MatrixReader : public TraceReader {
@@ -82,6 +294,56 @@ protected:
   virtual void handle(float_vector&);
 };
 
+// Collects data lines column by column, each column is stored contiguously.
+// Columns missing in a line are filled with zeros. With column selection
+// only selected columns are stored, in index order.
+class ColumnReader : public TraceReader {
+	std::vector<column_buffer*>	data;
+	size_t	rowCount;
+
+	ColumnReader(const ColumnReader&);
+	ColumnReader& operator=(const ColumnReader&);
+
+public:
+	ColumnReader() : rowCount(0) {
+		needDataLine = true;
+	};
+	~ColumnReader();
+
+	inline size_t rows() const {
+		return rowCount;
+	}
+	inline size_t columns() const {
+		return data.size();
+	}
+
+	// column view, valid until the next read
+	inline const column_buffer& operator[](size_t index) const {
+		return *data[index];
+	}
+
+	inline const std::vector<std::string>& titles() const {
+		return dataTitles;
+	}
+
+	void clear();
+
+protected:
+  virtual void handle(float_vector&);
+};
+
+class DenseMatrixReader : public TraceReader {
+	dense_matrix&	matrix;
+
+public:
+	DenseMatrixReader(dense_matrix& dest) : matrix(dest) {
+		needDataLine = true;
+	};
+
+protected:
+  virtual void handle(float_vector&);
+};
+
 }
 
 #endif  //  __MD_TRACEREADER_H_743743657364573465743657
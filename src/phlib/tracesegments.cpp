@@ -0,0 +1,122 @@
+/*
+ * tracesegments.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<ctype.h>
+#include	<sys/types.h>
+#include	<sys/stat.h>
+#include	<map>
+#ifdef	_MSC_VER
+#include	<io.h>
+#else
+#include	<dirent.h>
+#endif
+#include	"tracesegments.h"
+
+namespace phlib {
+
+// closed segment numbers mapped to file names, not compressed preferred
+typedef std::map<unsigned, std::string>	SegmentMap;
+
+// accepts <base>.<n>, <base>.<n>.gz and <base>.<n>.zst
+static bool parseSegment(const char* entry, const std::string& base, unsigned& number, bool& compressed)
+{
+	if (0 != ::strncmp(entry, base.c_str(), base.size()) || '.' != entry[base.size()])
+		return false;
+
+	const char*	p = entry + base.size() + 1;
+	if (!isdigit(static_cast<unsigned char>(*p)))
+		return false;
+
+	char*	end;
+	const unsigned long	n = ::strtoul(p, &end, 10);
+	if (0 == n || n > 0xffffffffUL)
+		return false;
+
+	number = static_cast<unsigned>(n);
+	compressed = 0 == ::strcmp(end, ".gz") || 0 == ::strcmp(end, ".zst");
+	return compressed || '\0' == *end;
+}
+
+static void addSegment(SegmentMap& segments, const std::string& path, unsigned number, bool compressed)
+{
+	SegmentMap::iterator	i = segments.find(number);
+	if (segments.end() == i)
+		segments[number] = path;
+	else if (!compressed)
+		i->second = path;
+}
+
+static void findSegments(const std::string& filename, SegmentMap& segments)
+{
+	// directory part keeps its separator
+	const std::string::size_type	slash = filename.find_last_of("/\\");
+	const std::string	dir = std::string::npos == slash ? std::string() : filename.substr(0, slash + 1);
+	const std::string	base = std::string::npos == slash ? filename : filename.substr(slash + 1);
+
+	unsigned	number;
+	bool	compressed;
+
+#ifdef	_MSC_VER
+	_finddata_t	entry;
+	const intptr_t	handle = ::_findfirst((filename + ".*").c_str(), &entry);
+	if (-1 == handle)
+		return;
+	do {
+		if (parseSegment(entry.name, base, number, compressed))
+			addSegment(segments, dir + entry.name, number, compressed);
+	} while (0 == ::_findnext(handle, &entry));
+	::_findclose(handle);
+#else
+	DIR*	d = ::opendir(dir.empty() ? "." : dir.c_str());
+	if (!d)
+		return;
+	while (const dirent* entry = ::readdir(d))
+		if (parseSegment(entry->d_name, base, number, compressed))
+			addSegment(segments, dir + entry->d_name, number, compressed);
+	::closedir(d);
+#endif
+}
+
+std::string traceSegmentName(const std::string& filename, unsigned number)
+{
+	char	buf[16];
+	::sprintf(buf, ".%u", number);
+	return filename + buf;
+}
+
+std::vector<std::string> traceSegments(const std::string& filename)
+{
+	SegmentMap	segments;
+	findSegments(filename, segments);
+
+	std::vector<std::string>	result;
+	for (SegmentMap::const_iterator i = segments.begin(); i != segments.end(); i++)
+		result.push_back(i->second);
+
+	struct stat	st;
+	if (0 == ::stat(filename.c_str(), &st))
+		result.push_back(filename);
+	return result;
+}
+
+unsigned lastTraceSegment(const std::string& filename)
+{
+	SegmentMap	segments;
+	findSegments(filename, segments);
+	return segments.empty() ? 0 : segments.rbegin()->first;
+}
+
+}
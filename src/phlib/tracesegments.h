@@ -0,0 +1,43 @@
+/*
+ * tracesegments.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Rotated trace files. When file <name> is rotated it is renamed to
+ * closed segment <name>.<n>, n = 1, 2, ..., and written anew. Closed
+ * segments may be compressed later into <name>.<n>.gz or <name>.<n>.zst.
+ * Closed segments in number order followed by <name> itself make one
+ * logical trace.
+ */
+
+#ifndef	__MD_TRACESEGMENTS_H_564738291029384756473829
+#define	__MD_TRACESEGMENTS_H_564738291029384756473829
+
+#include	<string>
+#include	<vector>
+
+namespace phlib {
+
+// name of closed segment <number> before compression
+std::string traceSegmentName(const std::string& filename, unsigned number);
+
+// Existing closed segments in number order and the file itself if it
+// exists. Segment present both compressed and not, i.e. being compressed,
+// is listed once, not compressed.
+std::vector<std::string> traceSegments(const std::string& filename);
+
+// number of the last closed segment, 0 if there are none
+unsigned lastTraceSegment(const std::string& filename);
+
+}
+
+#endif	//	__MD_TRACESEGMENTS_H_564738291029384756473829
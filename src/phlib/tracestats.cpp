@@ -0,0 +1,260 @@
+/*
+ * tracestats.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<math.h>
+#include	<algorithm>
+#include	"tracestats.h"
+#include	"vectorkernels.h"
+
+namespace phlib {
+
+///////////////////////////////////////////
+//
+// QuantileEstimator members
+//
+///////////////////////////////////////////
+
+QuantileEstimator::QuantileEstimator(double p) : probability(std::min(std::max(p, 0.0), 1.0)), count(0)
+{
+	const double	q = probability;
+	const double	d[5] = {1.0, 1.0 + 2.0 * q, 1.0 + 4.0 * q, 3.0 + 2.0 * q, 5.0};
+	const double	i[5] = {0.0, q / 2.0, q, (1.0 + q) / 2.0, 1.0};
+
+	for (int k = 0; k < 5; k++) {
+		heights[k] = 0.0;
+		positions[k] = k + 1;
+		desired[k] = d[k];
+		increments[k] = i[k];
+	}
+}
+
+void QuantileEstimator::add(double x)
+{
+	if (count < 5) {
+		heights[count++] = x;
+		if (5 == count)
+			std::sort(heights, heights + 5);
+		return;
+	}
+	count++;
+
+	// cell of the new value, extreme markers follow extreme values
+	int	k;
+	if (x < heights[0]) {
+		heights[0] = x;
+		k = 0;
+	}
+	else if (x >= heights[4]) {
+		heights[4] = x;
+		k = 3;
+	}
+	else
+		for (k = 0; x >= heights[k + 1]; k++);
+
+	for (int i = k + 1; i < 5; i++)
+		positions[i] += 1.0;
+	for (int i = 0; i < 5; i++)
+		desired[i] += increments[i];
+
+	// middle markers are moved to their desired positions
+	for (int i = 1; i < 4; i++) {
+		const double	d = desired[i] - positions[i];
+		if ((d >= 1.0 && positions[i + 1] - positions[i] > 1.0)
+				|| (d <= -1.0 && positions[i - 1] - positions[i] < -1.0)) {
+			const int	s = d > 0.0 ? 1 : -1;
+
+			// piecewise parabolic prediction
+			const double	h = heights[i] + s / (positions[i + 1] - positions[i - 1])
+				* ((positions[i] - positions[i - 1] + s) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i])
+				+ (positions[i + 1] - positions[i] - s) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+
+			if (heights[i - 1] < h && h < heights[i + 1])
+				heights[i] = h;
+			else
+				heights[i] += s * (heights[i + s] - heights[i]) / (positions[i + s] - positions[i]);
+			positions[i] += s;
+		}
+	}
+}
+
+double QuantileEstimator::value() const
+{
+	if (count >= 5)
+		return heights[2];
+	if (0 == count)
+		return 0.0;
+
+	double	sorted[5];
+	std::copy(heights, heights + count, sorted);
+	std::sort(sorted, sorted + count);
+	return sorted[static_cast<size_t>(probability * (count - 1) + 0.5)];
+}
+
+///////////////////////////////////////////
+//
+// ColumnStatistics members
+//
+///////////////////////////////////////////
+
+ColumnStatistics::ColumnStatistics(double peakZero) : n(0), total(0.0), compensation(0.0),
+		average(0.0), squares(0.0), lowest(0.0), highest(0.0), zero(peakZero), pike(0.0)
+{
+}
+
+void ColumnStatistics::addQuantile(double p)
+{
+	quantiles.push_back(QuantileEstimator(p));
+}
+
+// Neumaier's variant of Kahan summation
+inline void ColumnStatistics::addSum(double v)
+{
+	const double	t = total + v;
+	if (::fabs(total) >= ::fabs(v))
+		compensation += (total - t) + v;
+	else
+		compensation += (v - t) + total;
+	total = t;
+}
+
+void ColumnStatistics::add(double v)
+{
+	if (0 == n)
+		lowest = highest = pike = v;
+	else {
+		if (v < lowest)
+			lowest = v;
+		if (v > highest)
+			highest = v;
+		if (::fabs(v - zero) > ::fabs(pike - zero))
+			pike = v;
+	}
+
+	// Welford's update
+	n++;
+	const double	delta = v - average;
+	average += delta / n;
+	squares += delta * (v - average);
+
+	addSum(v);
+
+	for (std::vector<QuantileEstimator>::iterator i = quantiles.begin(); i != quantiles.end(); i++)
+		i->add(v);
+}
+
+void ColumnStatistics::add(const double* values, size_t count)
+{
+	if (0 == count)
+		return;
+
+	// statistics of the block
+	ColumnStatistics	block(zero);
+	block.n = count;
+	block.lowest = vectorKernels().min(values, count);
+	block.highest = vectorKernels().max(values, count);
+	block.pike = ::fabs(block.lowest - zero) >= ::fabs(block.highest - zero) ? block.lowest : block.highest;
+
+	for (size_t i = 0; i < count; i++)
+		block.addSum(values[i]);
+	block.average = block.sum() / count;
+
+	// the second pass over the block, still in cache
+	for (size_t i = 0; i < count; i++) {
+		const double	d = values[i] - block.average;
+		block.squares += d * d;
+	}
+
+	merge(block);
+
+	for (std::vector<QuantileEstimator>::iterator q = quantiles.begin(); q != quantiles.end(); q++)
+		for (size_t i = 0; i < count; i++)
+			q->add(values[i]);
+}
+
+void ColumnStatistics::merge(const ColumnStatistics& v)
+{
+	if (0 == v.n)
+		return;
+
+	if (0 == n) {
+		lowest = v.lowest;
+		highest = v.highest;
+		pike = v.pike;
+	}
+	else {
+		lowest = std::min(lowest, v.lowest);
+		highest = std::max(highest, v.highest);
+		if (::fabs(v.pike - zero) > ::fabs(pike - zero))
+			pike = v.pike;
+	}
+
+	// Chan's formulae for pairwise update
+	const double	na = static_cast<double>(n), nb = static_cast<double>(v.n), nab = na + nb;
+	const double	delta = v.average - average;
+	average += delta * nb / nab;
+	squares += v.squares + delta * delta * na * nb / nab;
+	n += v.n;
+
+	addSum(v.total);
+	addSum(v.compensation);
+}
+
+double ColumnStatistics::deviation() const
+{
+	return ::sqrt(variance());
+}
+
+///////////////////////////////////////////
+//
+// StatisticsReader members
+//
+///////////////////////////////////////////
+
+StatisticsReader::StatisticsReader(double peakZero) : peakZero(peakZero)
+{
+	setBatchSize(BatchSize);
+}
+
+void StatisticsReader::addQuantile(double p)
+{
+	probabilities.push_back(p);
+	for (std::vector<ColumnStatistics>::iterator i = stats.begin(); i != stats.end(); i++)
+		i->addQuantile(p);
+}
+
+ColumnStatistics& StatisticsReader::column(int index)
+{
+	while (static_cast<int>(stats.size()) <= index) {
+		stats.push_back(ColumnStatistics(peakZero));
+		for (std::vector<double>::const_iterator i = probabilities.begin(); i != probabilities.end(); i++)
+			stats.back().addQuantile(*i);
+	}
+	return stats[index];
+}
+
+void StatisticsReader::clear()
+{
+	stats.clear();
+}
+
+void StatisticsReader::handle(int index, double value)
+{
+	column(index).add(value);
+}
+
+void StatisticsReader::handle(int index, const double* values, size_t count)
+{
+	column(index).add(values, count);
+}
+
+}
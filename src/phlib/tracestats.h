@@ -0,0 +1,146 @@
+/*
+ * tracestats.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Single pass statistics of trace columns. Values are never stored:
+ * sums are compensated (Kahan-Neumaier), variance is updated by Welford's
+ * method and blocks are merged by Chan's formulae, quantiles are estimated
+ * with the P-square algorithm of Jain and Chlamtac.
+ */
+
+#ifndef	__MD_TRACESTATS_H_102938475610293847561029
+#define	__MD_TRACESTATS_H_102938475610293847561029
+
+#include	<stddef.h>
+#include	<vector>
+#include	"tracereader.h"
+
+namespace phlib {
+
+// estimate of a quantile taking constant memory
+class QuantileEstimator {
+	double	probability;
+	size_t	count;
+	double	heights[5];	// marker heights, first values until there are 5
+	double	positions[5];
+	double	desired[5];	// desired positions of markers
+	double	increments[5];
+
+public:
+	// 0 <= p <= 1, e.g. 0.5 for median
+	explicit QuantileEstimator(double p);
+
+	void add(double x);
+
+	inline double p() const {
+		return probability;
+	}
+	// exact value while there are less than 5 values, 0 without values
+	double value() const;
+};
+
+class ColumnStatistics {
+	size_t	n;
+	double	total, compensation;	// sum is total + compensation
+	double	average, squares;	// mean and sum of squared deviations
+	double	lowest, highest;
+	double	zero, pike;	// peak is the value farthest from zero
+	std::vector<QuantileEstimator>	quantiles;
+
+	void addSum(double v);
+
+public:
+	// peak is measured from <peakZero>
+	explicit ColumnStatistics(double peakZero = 0.0);
+
+	// estimates of <p>-quantile are made from values added later
+	void addQuantile(double p);
+
+	void add(double v);
+	void add(const double* values, size_t count);
+
+	// quantile estimates of <v> are not merged
+	void merge(const ColumnStatistics& v);
+
+	inline size_t count() const {
+		return n;
+	}
+	inline double sum() const {
+		return total + compensation;
+	}
+	inline double mean() const {
+		return average;
+	}
+	// unbiased, 0 for less than 2 values
+	inline double variance() const {
+		return n > 1 ? squares / (n - 1) : 0.0;
+	}
+	double deviation() const;
+
+	// 0 without values
+	inline double minimum() const {
+		return lowest;
+	}
+	inline double maximum() const {
+		return highest;
+	}
+	inline double peak() const {
+		return pike;
+	}
+
+	inline size_t quantileCount() const {
+		return quantiles.size();
+	}
+	inline const QuantileEstimator& quantile(size_t i) const {
+		return quantiles[i];
+	}
+};
+
+// Collects statistics of every column, numbers are passed in blocks.
+// Statistics are accumulated over all reads until clear().
+class StatisticsReader : public TraceReader {
+	std::vector<ColumnStatistics>	stats;
+	std::vector<double>	probabilities;
+	double	peakZero;
+
+	ColumnStatistics& column(int index);
+
+public:
+	enum {BatchSize = 4096};
+
+	explicit StatisticsReader(double peakZero = 0.0);
+
+	// quantile estimates for all columns, should be requested before reading
+	void addQuantile(double p);
+
+	inline size_t columns() const {
+		return stats.size();
+	}
+	inline const ColumnStatistics& operator[](size_t index) const {
+		return stats[index];
+	}
+
+	inline const std::vector<std::string>& titles() const {
+		return dataTitles;
+	}
+
+	void clear();
+
+protected:
+	virtual void handle(int index, double value);
+	virtual void handle(int index, const double* values, size_t count);
+};
+
+}
+
+#endif	//	__MD_TRACESTATS_H_102938475610293847561029
@@ -0,0 +1,460 @@
+/*
+ * tracewriter.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<limits.h>
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<algorithm>
+#ifdef	_MSC_VER
+#include	<io.h>
+#include	<sys/stat.h>
+#else
+#include	<unistd.h>
+#endif
+#include	<zlib.h>
+#include	"tracewriter.h"
+#include	"tracesegments.h"
+#include	"thread.h"
+
+namespace phlib {
+
+///////////////////////////////////////////
+//
+// TraceWriter::Flusher members
+//
+///////////////////////////////////////////
+
+// writes filled blocks on a separate thread while the caller fills next ones
+class TraceWriter::Flusher : public Runnable {
+	TraceWriter&	owner;
+	std::vector<std::vector<char> >	blocks;
+	std::vector<size_t>	sizes;
+	size_t	head, tail, count;	// first filled block, block being filled, number of filled blocks
+	bool	stopping;
+	bool	failure;
+	Mutex	mutex;
+	Condition	changed;
+	Thread	thread;
+
+public:
+	Flusher(TraceWriter& owner, unsigned n) : owner(owner), blocks(std::max(n, 2u)), sizes(blocks.size()),
+			head(0), tail(0), count(0), stopping(false), failure(false) {
+		for (size_t i = 0; i < blocks.size(); i++)
+			blocks[i].resize(BufferSize);
+		thread.start(*this);
+	}
+
+	// all filled blocks are written
+	virtual ~Flusher() {
+		{
+			ScopedLock	lock(mutex);
+			stopping = true;
+			changed.broadcast();
+		}
+		thread.join();
+	}
+
+	virtual void run() {
+		for (;;) {
+			const char*	p;
+			size_t	n;
+			{
+				ScopedLock	lock(mutex);
+				while (0 == count && !stopping)
+					changed.wait(mutex);
+				if (0 == count)
+					return;
+				p = &blocks[head][0];
+				n = sizes[head];
+			}
+
+			// after an error blocks are dropped, the caller must not wait
+			const bool	ok = failure || owner.output(p, n);
+
+			ScopedLock	lock(mutex);
+			if (!ok)
+				failure = true;
+			head = (head + 1) % blocks.size();
+			count--;
+			changed.broadcast();
+		}
+	}
+
+	inline char* block() {
+		return &blocks[tail][0];
+	}
+
+	// passes <size> bytes of the current block for writing and returns the
+	// next block, waits while all blocks are filled
+	char* submit(size_t size) {
+		ScopedLock	lock(mutex);
+
+		sizes[tail] = size;
+		count++;
+		changed.broadcast();
+		tail = (tail + 1) % blocks.size();
+
+		while (blocks.size() == count)
+			changed.wait(mutex);
+		return &blocks[tail][0];
+	}
+
+	bool failed() {
+		ScopedLock	lock(mutex);
+		return failure;
+	}
+};
+
+///////////////////////////////////////////
+//
+// TraceWriter::SegmentCompressor members
+//
+///////////////////////////////////////////
+
+// gzip-compresses closed segment on a separate thread
+class TraceWriter::SegmentCompressor : public Runnable {
+	enum {ChunkSize = 256 * 1024};
+
+	const std::string	segment;
+	bool	done;
+	Mutex	mutex;
+	Thread	thread;
+
+	void compress();
+
+public:
+	SegmentCompressor(const std::string& segment) : segment(segment), done(false) {
+		thread.start(*this);
+	}
+
+	virtual ~SegmentCompressor() {
+		thread.join();
+	}
+
+	virtual void run() {
+		compress();
+
+		ScopedLock	lock(mutex);
+		done = true;
+	}
+
+	// compression is over, destruction does not wait
+	bool finished() {
+		ScopedLock	lock(mutex);
+		return done;
+	}
+};
+
+void TraceWriter::SegmentCompressor::compress()
+{
+	// compressed copy is written under temporary name, so readers
+	// always find the segment complete in one of forms
+	const std::string	target = segment + ".gz", temporary = target + ".tmp";
+
+	FILE*	src = ::fopen(segment.c_str(), "rb");
+	if (!src)
+		return;
+	gzFile	dest = ::gzopen(temporary.c_str(), "wb");
+	if (!dest) {
+		::fclose(src);
+		return;
+	}
+
+	std::vector<char>	chunk(ChunkSize);
+	bool	ok = true;
+	for (size_t n; ok && (n = ::fread(&chunk[0], 1, chunk.size(), src)) > 0; )
+		ok = ::gzwrite(dest, &chunk[0], static_cast<unsigned>(n)) == static_cast<int>(n);
+	ok = Z_OK == ::gzclose(dest) && ok && !::ferror(src);
+	::fclose(src);
+
+	if (ok && 0 == ::rename(temporary.c_str(), target.c_str()))
+		::remove(segment.c_str());
+	else
+		::remove(temporary.c_str());
+}
+
+///////////////////////////////////////////
+//
+// TraceWriter members
+//
+///////////////////////////////////////////
+
+TraceWriter::TraceWriter(const std::string& fileName, bool do_open) : FileChecker(fileName),
+		name(getFileName(fileName)), fd(-1), buffer(BufferSize), flusher(0), precision(0),
+		syncInterval(0), unsynced(0), error(false), asyncBlocks(0), rotating(false),
+		rotationBytes(0), rotationSeconds(0), compressSegments(false),
+		written(getInitialFileSize()), segmentStart(::time(0))
+{
+	setBlock(&buffer[0]);
+
+	if (do_open)
+		open(fileName);
+}
+
+TraceWriter::~TraceWriter()
+{
+	close();
+	reapCompressors(true);
+}
+
+void TraceWriter::open(const std::string& fileName)
+{
+	const std::ios_base::openmode	mode = getFileOpenMode(fileName);
+	const std::string	name = getFileName(fileName);
+	if (0 == mode || name.empty())
+		return;
+
+#ifdef	_MSC_VER
+	fd = ::_open(name.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | ((mode & std::ios_base::app) ? _O_APPEND : _O_TRUNC),
+		_S_IREAD | _S_IWRITE);
+#else
+	fd = ::open(name.c_str(), O_WRONLY | O_CREAT | ((mode & std::ios_base::app) ? O_APPEND : O_TRUNC), 0666);
+#endif
+	if (fd < 0)
+		error = true;
+}
+
+void TraceWriter::close()
+{
+	flush();
+
+	if (flusher) {
+		if (flusher->failed())
+			error = true;
+		delete flusher;
+		flusher = 0;
+		setBlock(&buffer[0]);
+	}
+
+	if (fd >= 0) {
+		if (syncInterval > 0 && unsynced > 0 && !error && !sync())
+			error = true;
+#ifdef	_MSC_VER
+		::_close(fd);
+#else
+		::close(fd);
+#endif
+		fd = -1;
+	}
+}
+
+void TraceWriter::setAsync(unsigned blocks)
+{
+	flush();
+	asyncBlocks = blocks;
+
+	if (flusher) {
+		if (flusher->failed())
+			error = true;
+		delete flusher;
+		flusher = 0;
+	}
+
+#ifndef	_MSC_VER
+	// threads are not available with MSVC, see thread.h
+	if (blocks > 0 && isOpen()) {
+		flusher = new Flusher(*this, blocks);
+		setBlock(flusher->block());
+		return;
+	}
+#endif	//	_MSC_VER
+
+	setBlock(&buffer[0]);
+}
+
+void TraceWriter::writeHeader(const std::string& text)
+{
+	header = text;
+	if (isHeaderRequired())
+		*this << text;
+}
+
+void TraceWriter::setRotation(unsigned long long bytes, unsigned seconds, bool compress)
+{
+	rotationBytes = bytes;
+	rotationSeconds = seconds;
+	compressSegments = compress;
+	rotating = bytes > 0 || seconds > 0;
+}
+
+void TraceWriter::rotateIfDue()
+{
+	if ((rotationBytes > 0 && written + (position - start) >= rotationBytes)
+			|| (rotationSeconds > 0 && ::time(0) - segmentStart >= static_cast<time_t>(rotationSeconds)))
+		rotate();
+}
+
+void TraceWriter::rotate()
+{
+	if (!isOpen())
+		return;
+
+	close();
+
+	// file that cannot be renamed is continued till the next rotation
+	const std::string	segment = traceSegmentName(name, lastTraceSegment(name) + 1);
+	const bool	renamed = 0 == ::rename(name.c_str(), segment.c_str());
+	open(renamed ? name : '+' + name);
+	segmentStart = ::time(0);
+	written = 0;
+
+	// header does not trigger rotation even if it is longer than the limit
+	if (renamed) {
+		rotating = false;
+		*this << header;
+		rotating = true;
+	}
+	if (asyncBlocks > 0)
+		setAsync(asyncBlocks);
+
+	// logging never waits for compression of previous segments
+	reapCompressors(false);
+	if (renamed && compressSegments)
+		compressors.push_back(new SegmentCompressor(segment));
+}
+
+// destroys compressors that are over, or all of them when <wait> is true
+void TraceWriter::reapCompressors(bool wait)
+{
+	std::vector<SegmentCompressor*>	running;
+	for (size_t i = 0; i < compressors.size(); i++) {
+		if (wait || compressors[i]->finished())
+			delete compressors[i];
+		else
+			running.push_back(compressors[i]);
+	}
+	compressors.swap(running);
+}
+
+void TraceWriter::setBlock(char* block)
+{
+	start = position = block;
+	limit = block + BufferSize - FormatBufferSize;
+}
+
+// writes data to the file and synchronizes it with disk by the policy
+bool TraceWriter::output(const char* data, size_t size)
+{
+	while (size > 0) {
+#ifdef	_MSC_VER
+		const int	n = ::_write(fd, data, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+#else
+		const ssize_t	n = ::write(fd, data, std::min<size_t>(size, INT_MAX));
+#endif
+		if (n < 0) {
+			if (EINTR == errno)
+				continue;
+			return false;
+		}
+		data += n;
+		size -= n;
+		unsynced += n;
+	}
+
+	if (syncInterval > 0 && unsynced >= syncInterval)
+		return sync();
+	return true;
+}
+
+bool TraceWriter::sync()
+{
+	unsynced = 0;
+#if	defined(_MSC_VER)
+	return 0 == ::_commit(fd);
+#elif	defined(__APPLE__)
+	return 0 == ::fsync(fd);
+#else
+	return 0 == ::fdatasync(fd);
+#endif
+}
+
+void TraceWriter::flush()
+{
+	const size_t	size = position - start;
+	if (0 == size)
+		return;
+	written += size;
+
+	if (flusher) {
+		setBlock(flusher->submit(size));
+		return;
+	}
+
+	position = start;
+	if (isOpen() && !error && !output(start, size))
+		error = true;
+}
+
+bool TraceWriter::failed() const
+{
+	return error || (flusher && flusher->failed());
+}
+
+// copies <n> characters, rotation is checked after each line feed
+void TraceWriter::append(const char* s, size_t n)
+{
+	for (const char* end = s + n; s < end; ) {
+		const char*	stop = end;
+		if (rotating) {
+			const char*	lf = static_cast<const char*>(::memchr(s, '\n', end - s));
+			if (lf)
+				stop = lf + 1;
+		}
+
+		while (s < stop) {
+			if (start + BufferSize == position)
+				flush();
+			const size_t	k = std::min<size_t>(stop - s, start + BufferSize - position);
+			::memcpy(position, s, k);
+			position += k;
+			s += k;
+		}
+
+		if (rotating && '\n' == s[-1])
+			rotateIfDue();
+	}
+}
+
+TraceWriter& TraceWriter::operator<<(const char* s)
+{
+	append(s, ::strlen(s));
+	return *this;
+}
+
+TraceWriter& TraceWriter::operator<<(const std::string& s)
+{
+	append(s.data(), s.size());
+	return *this;
+}
+
+void TraceWriter::writeLine(const float_vector& v)
+{
+	for (float_vector::const_iterator i = v.begin(); i != v.end(); i++) {
+		if (position > limit)
+			flush();
+		if (i != v.begin())
+			*position++ = '\t';
+		position = formatDouble(*i, position, precision);
+	}
+
+	if (position > limit)
+		flush();
+	*position++ = '\n';
+
+	if (rotating)
+		rotateIfDue();
+}
+
+}
@@ -0,0 +1,166 @@
+/*
+ * tracewriter.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_TRACEWRITER_H_647382910564738291056473
+#define	__MD_TRACEWRITER_H_647382910564738291056473
+
+#include	<stddef.h>
+#include	<time.h>
+#include	<string>
+#include	<vector>
+#include	"tracestream.h"
+#include	"floatvector.h"
+#include	"numformat.h"
+
+namespace phlib {
+
+// Buffered writer of trace files, a faster replacement of TraceStream.
+// File names follow TraceStream rules: "+name" appends to the file and
+// empty name opens nothing. Data is collected in a large buffer and
+// written by big blocks; numbers are written by formatDouble(), so text
+// does not depend on locale and TraceReader reads exactly the same values.
+// In asynchronous mode full blocks are written on a separate thread, so
+// the caller does not wait for slow disks. Long written files may be
+// rotated by size or age. Writer is not thread-safe.
+class TraceWriter : protected FileChecker {
+	class Flusher;
+	class SegmentCompressor;
+
+	std::string	name;	// without '+'
+	int	fd;
+	std::vector<char>	buffer;
+	Flusher*	flusher;	// asynchronous mode
+	char*	start;	// current block
+	char*	position;	// end of buffered data
+	char*	limit;	// position beyond which a number may not fit
+	int	precision;
+	unsigned long long	syncInterval, unsynced;
+	bool	error;
+	unsigned	asyncBlocks;
+	std::string	header;
+	bool	rotating;
+	unsigned long long	rotationBytes;
+	unsigned	rotationSeconds;
+	bool	compressSegments;
+	unsigned long long	written;	// bytes of the file, buffered ones excluded
+	time_t	segmentStart;
+	std::vector<SegmentCompressor*>	compressors;	// running or finished, see rotate()
+
+	void open(const std::string& fileName);
+	void setBlock(char* block);
+	void append(const char* s, size_t n);
+	bool output(const char* data, size_t size);
+	bool sync();
+	void rotateIfDue();
+	void rotate();
+	void reapCompressors(bool wait);
+
+	TraceWriter(const TraceWriter&);
+	TraceWriter& operator=(const TraceWriter&);
+
+public:
+	enum {
+		BufferSize = 1024 * 1024,
+		DefaultBlocks = 4	// blocks in asynchronous mode
+	};
+
+	explicit TraceWriter(const std::string& fileName, bool do_open = true);
+	virtual ~TraceWriter();	// buffered data is written
+
+	inline bool isOpen() const {
+		return fd >= 0;
+	}
+
+	inline bool isHeaderRequired() const {
+		return isNew() || getInitialFileSize() == 0;
+	}
+
+	// significant digits of numbers, 0 means as many as needed to read
+	// numbers back exactly, in the shortest form (default)
+	inline void setPrecision(int digits) {
+		precision = digits;
+	}
+
+	// Full blocks are written on a separate thread; up to <blocks> blocks
+	// of BufferSize bytes wait for writing, the caller is blocked only when
+	// all of them are full. 0 switches back to synchronous writing.
+	// Under MSVC writing is always synchronous, see thread.h.
+	void setAsync(unsigned blocks = DefaultBlocks);
+
+	// file is synchronized with disk after each <bytes> written and when
+	// closed, 0 means never (default); is set before setAsync()
+	inline void setSyncInterval(unsigned long long bytes) {
+		syncInterval = bytes;
+	}
+
+	// Header is written now if isHeaderRequired(), and at the beginning of
+	// every segment started by rotation.
+	void writeHeader(const std::string& text);
+
+	// When the file reaches <bytes> or is written for <seconds>, 0 means no
+	// limit, it is renamed to the next closed segment (see tracesegments.h)
+	// and started anew. Rotation happens at line ends, that is after line
+	// feed character, in strings too, and writeLine(). Closed segments are gzip-compressed on
+	// a separate thread when <compress> is true.
+	void setRotation(unsigned long long bytes, unsigned seconds, bool compress = false);
+
+	inline TraceWriter& operator<<(double v) {
+		if (position > limit)
+			flush();
+		position = formatDouble(v, position, precision);
+		return *this;
+	}
+
+	inline TraceWriter& operator<<(int v) {
+		if (position > limit)
+			flush();
+		position = formatInteger(v, position);
+		return *this;
+	}
+
+	inline TraceWriter& operator<<(long v) {
+		if (position > limit)
+			flush();
+		position = formatInteger(v, position);
+		return *this;
+	}
+
+	inline TraceWriter& operator<<(char c) {
+		if (position > limit)
+			flush();
+		*position++ = c;
+		if (rotating && '\n' == c)
+			rotateIfDue();
+		return *this;
+	}
+
+	TraceWriter& operator<<(const char* s);
+	TraceWriter& operator<<(const std::string& s);
+
+	// tab separated values and line feed
+	void writeLine(const float_vector& v);
+
+	// passes buffered data to the file, in asynchronous mode to the
+	// writing thread
+	void flush();
+
+	// writes all data and closes the file
+	void close();
+
+	// data cannot be written
+	bool failed() const;
+};
+
+}
+
+#endif	//	__MD_TRACEWRITER_H_647382910564738291056473
@@ -0,0 +1,317 @@
+/*
+ * vectorexpr.hpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * vectorexpr.hpp
+ *
+ * Lazy element-wise expressions over float_vector. An expression like
+ *   acc = clamp(acc + a + k * b, 0.0, 1.0);
+ * builds a tree of light-weight nodes and is evaluated in a single pass
+ * when assigned to a float_vector, without temporary vectors.
+ *
+ * Size of an expression is the largest size of its vector operands.
+ * Shorter operands are padded with zeros, like float_vector::operator+= does.
+ * Expressions keep pointers to the data of their operands, so they must be
+ * evaluated before any operand is resized or destroyed.
+ */
+
+#ifndef VECTOREXPR_HPP_
+#define VECTOREXPR_HPP_
+
+#include <vector>
+#include <stddef.h>
+#include <math.h>
+
+namespace phlib {
+
+	class float_vector;
+
+	template <class E>
+	struct vector_expression {
+		inline const E& self() const {
+			return static_cast<const E&>(*this);
+		}
+	};
+
+	// leaf node referring to vector data
+	class vector_terminal : public vector_expression<vector_terminal> {
+
+		const double* data;
+		size_t n;
+
+	public:
+
+		explicit vector_terminal(const std::vector<double>& v) :
+			data(v.empty() ? 0 : &v[0]),
+			n(v.size())
+		{}
+
+		vector_terminal(const double* data, size_t n) :
+			data(data),
+			n(n)
+		{}
+
+		inline size_t size() const {
+			return n;
+		}
+
+		// true if all the operands have at least <sz> elements
+		inline bool dense(size_t sz) const {
+			return n >= sz;
+		}
+
+		inline double operator[](size_t i) const {
+			return data[i];
+		}
+
+		inline double at(size_t i) const {
+			return i < n ? data[i] : 0.0;
+		}
+	};
+
+	// leaf node holding a constant
+	class vector_scalar : public vector_expression<vector_scalar> {
+
+		double value;
+
+	public:
+
+		explicit vector_scalar(double value) :
+			value(value)
+		{}
+
+		inline size_t size() const {
+			return 0;
+		}
+
+		inline bool dense(size_t) const {
+			return true;
+		}
+
+		inline double operator[](size_t) const {
+			return value;
+		}
+
+		inline double at(size_t) const {
+			return value;
+		}
+	};
+
+	template <class L, class R, class Op>
+	class vector_binary : public vector_expression<vector_binary<L, R, Op> > {
+
+		L left;
+		R right;
+
+	public:
+
+		vector_binary(const L& left, const R& right) :
+			left(left),
+			right(right)
+		{}
+
+		inline size_t size() const {
+			const size_t l = left.size(), r = right.size();
+			return l > r ? l : r;
+		}
+
+		inline bool dense(size_t sz) const {
+			return left.dense(sz) && right.dense(sz);
+		}
+
+		inline double operator[](size_t i) const {
+			return Op::apply(left[i], right[i]);
+		}
+
+		inline double at(size_t i) const {
+			return Op::apply(left.at(i), right.at(i));
+		}
+	};
+
+	template <class E, class Op>
+	class vector_unary : public vector_expression<vector_unary<E, Op> > {
+
+		E arg;
+
+	public:
+
+		explicit vector_unary(const E& arg) :
+			arg(arg)
+		{}
+
+		inline size_t size() const {
+			return arg.size();
+		}
+
+		inline bool dense(size_t sz) const {
+			return arg.dense(sz);
+		}
+
+		inline double operator[](size_t i) const {
+			return Op::apply(arg[i]);
+		}
+
+		inline double at(size_t i) const {
+			return Op::apply(arg.at(i));
+		}
+	};
+
+	// same semantics as float_vector::setLowerBound() followed by setUpperBound()
+	template <class E>
+	class vector_clamp : public vector_expression<vector_clamp<E> > {
+
+		E arg;
+		double lower, upper;
+
+		static inline double apply(double x, double lower, double upper) {
+			if (x < lower)
+				x = lower;
+			if (x > upper)
+				x = upper;
+			return x;
+		}
+
+	public:
+
+		vector_clamp(const E& arg, double lower, double upper) :
+			arg(arg),
+			lower(lower),
+			upper(upper)
+		{}
+
+		inline size_t size() const {
+			return arg.size();
+		}
+
+		inline bool dense(size_t sz) const {
+			return arg.dense(sz);
+		}
+
+		inline double operator[](size_t i) const {
+			return apply(arg[i], lower, upper);
+		}
+
+		inline double at(size_t i) const {
+			return apply(arg.at(i), lower, upper);
+		}
+	};
+
+	namespace expr_ops {
+		struct plus {static inline double apply(double a, double b) {return a + b;}};
+		struct minus {static inline double apply(double a, double b) {return a - b;}};
+		struct multiplies {static inline double apply(double a, double b) {return a * b;}};
+		struct divides {static inline double apply(double a, double b) {return a / b;}};
+		struct negate {static inline double apply(double a) {return -a;}};
+		struct abs {static inline double apply(double a) {return ::fabs(a);}};
+		struct sqrt {static inline double apply(double a) {return ::sqrt(a);}};
+	}
+
+	// evaluate expression into <n> elements at <dest>
+	template <class E>
+	void evaluate(double* dest, size_t n, const vector_expression<E>& e) {
+		const E& x = e.self();
+		if (x.dense(n)) {
+			for (size_t i = 0; i < n; i++)
+				dest[i] = x[i];
+		}
+		else {
+			for (size_t i = 0; i < n; i++)
+				dest[i] = x.at(i);
+		}
+	}
+
+	// float_vector is incomplete here, see floatvector.h for definition
+	inline vector_terminal make_operand(const float_vector& v);
+
+#define	PHLIB_VECTOREXPR_BINARY(op, Op) \
+	template <class L, class R> \
+	inline vector_binary<L, R, expr_ops::Op> op(const vector_expression<L>& l, const vector_expression<R>& r) { \
+		return vector_binary<L, R, expr_ops::Op>(l.self(), r.self()); \
+	} \
+	template <class L> \
+	inline vector_binary<L, vector_terminal, expr_ops::Op> op(const vector_expression<L>& l, const float_vector& r) { \
+		return vector_binary<L, vector_terminal, expr_ops::Op>(l.self(), make_operand(r)); \
+	} \
+	template <class R> \
+	inline vector_binary<vector_terminal, R, expr_ops::Op> op(const float_vector& l, const vector_expression<R>& r) { \
+		return vector_binary<vector_terminal, R, expr_ops::Op>(make_operand(l), r.self()); \
+	} \
+	inline vector_binary<vector_terminal, vector_terminal, expr_ops::Op> op(const float_vector& l, const float_vector& r) { \
+		return vector_binary<vector_terminal, vector_terminal, expr_ops::Op>(make_operand(l), make_operand(r)); \
+	} \
+	template <class L> \
+	inline vector_binary<L, vector_scalar, expr_ops::Op> op(const vector_expression<L>& l, double r) { \
+		return vector_binary<L, vector_scalar, expr_ops::Op>(l.self(), vector_scalar(r)); \
+	} \
+	template <class R> \
+	inline vector_binary<vector_scalar, R, expr_ops::Op> op(double l, const vector_expression<R>& r) { \
+		return vector_binary<vector_scalar, R, expr_ops::Op>(vector_scalar(l), r.self()); \
+	} \
+	inline vector_binary<vector_terminal, vector_scalar, expr_ops::Op> op(const float_vector& l, double r) { \
+		return vector_binary<vector_terminal, vector_scalar, expr_ops::Op>(make_operand(l), vector_scalar(r)); \
+	} \
+	inline vector_binary<vector_scalar, vector_terminal, expr_ops::Op> op(double l, const float_vector& r) { \
+		return vector_binary<vector_scalar, vector_terminal, expr_ops::Op>(vector_scalar(l), make_operand(r)); \
+	}
+
+	PHLIB_VECTOREXPR_BINARY(operator+, plus)
+	PHLIB_VECTOREXPR_BINARY(operator-, minus)
+	PHLIB_VECTOREXPR_BINARY(operator*, multiplies)
+	PHLIB_VECTOREXPR_BINARY(operator/, divides)
+
+#undef	PHLIB_VECTOREXPR_BINARY
+
+#define	PHLIB_VECTOREXPR_UNARY(op, Op) \
+	template <class E> \
+	inline vector_unary<E, expr_ops::Op> op(const vector_expression<E>& e) { \
+		return vector_unary<E, expr_ops::Op>(e.self()); \
+	} \
+	inline vector_unary<vector_terminal, expr_ops::Op> op(const float_vector& v) { \
+		return vector_unary<vector_terminal, expr_ops::Op>(make_operand(v)); \
+	}
+
+	PHLIB_VECTOREXPR_UNARY(operator-, negate)
+	PHLIB_VECTOREXPR_UNARY(abs, abs)
+	PHLIB_VECTOREXPR_UNARY(sqrt, sqrt)
+
+#undef	PHLIB_VECTOREXPR_UNARY
+
+	template <class E>
+	inline vector_clamp<E> clamp(const vector_expression<E>& e, double lower, double upper) {
+		return vector_clamp<E>(e.self(), lower, upper);
+	}
+
+	inline vector_clamp<vector_terminal> clamp(const float_vector& v, double lower, double upper) {
+		return vector_clamp<vector_terminal>(make_operand(v), lower, upper);
+	}
+
+	template <class E>
+	inline vector_clamp<E> lowerBound(const vector_expression<E>& e, double lower) {
+		return vector_clamp<E>(e.self(), lower, HUGE_VAL);
+	}
+
+	inline vector_clamp<vector_terminal> lowerBound(const float_vector& v, double lower) {
+		return vector_clamp<vector_terminal>(make_operand(v), lower, HUGE_VAL);
+	}
+
+	template <class E>
+	inline vector_clamp<E> upperBound(const vector_expression<E>& e, double upper) {
+		return vector_clamp<E>(e.self(), -HUGE_VAL, upper);
+	}
+
+	inline vector_clamp<vector_terminal> upperBound(const float_vector& v, double upper) {
+		return vector_clamp<vector_terminal>(make_operand(v), -HUGE_VAL, upper);
+	}
+}
+
+#endif /* VECTOREXPR_HPP_ */
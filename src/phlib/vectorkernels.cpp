@@ -0,0 +1,219 @@
+/*
+ * vectorkernels.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<string.h>
+#include	"vectorkernels.h"
+
+#if	defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define	PHLIB_X86_KERNELS
+#include	<immintrin.h>
+
+// keep results bit-identical across instruction sets:
+// AVX-512 implies FMA, and contracting a * b + c into it changes rounding
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace phlib {
+
+namespace scalar_kernels {
+
+typedef double	vec;
+enum {width = 1};
+
+static inline vec vload(const double* p) {return *p;}
+static inline void vstore(double* p, vec v) {*p = v;}
+static inline vec vset1(double x) {return x;}
+static inline vec vadd(vec a, vec b) {return a + b;}
+static inline vec vsub(vec a, vec b) {return a - b;}
+static inline vec vmul(vec a, vec b) {return a * b;}
+static inline vec vdiv(vec a, vec b) {return a / b;}
+static inline vec vmax(vec acc, vec x) {return acc < x ? x : acc;}
+static inline vec vmin(vec acc, vec x) {return acc > x ? x : acc;}
+static inline double hsum(vec v) {return v;}
+static inline double hmax(vec v) {return v;}
+static inline double hmin(vec v) {return v;}
+
+#define	KERNELS_NAME	"scalar"
+#include	"vectorkernels.inc"
+#undef	KERNELS_NAME
+
+}
+
+#ifdef	PHLIB_X86_KERNELS
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+namespace sse2_kernels {
+
+typedef __m128d	vec;
+enum {width = 2};
+
+static inline vec vload(const double* p) {return _mm_loadu_pd(p);}
+static inline void vstore(double* p, vec v) {_mm_storeu_pd(p, v);}
+static inline vec vset1(double x) {return _mm_set1_pd(x);}
+static inline vec vadd(vec a, vec b) {return _mm_add_pd(a, b);}
+static inline vec vsub(vec a, vec b) {return _mm_sub_pd(a, b);}
+static inline vec vmul(vec a, vec b) {return _mm_mul_pd(a, b);}
+static inline vec vdiv(vec a, vec b) {return _mm_div_pd(a, b);}
+static inline vec vmax(vec acc, vec x) {return _mm_max_pd(x, acc);}
+static inline vec vmin(vec acc, vec x) {return _mm_min_pd(x, acc);}
+
+static inline double hsum(vec v) {
+	return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static inline double hmax(vec v) {
+	return _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(v, v), v));
+}
+
+static inline double hmin(vec v) {
+	return _mm_cvtsd_f64(_mm_min_sd(_mm_unpackhi_pd(v, v), v));
+}
+
+#define	KERNELS_NAME	"sse2"
+#include	"vectorkernels.inc"
+#undef	KERNELS_NAME
+
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace avx2_kernels {
+
+typedef __m256d	vec;
+enum {width = 4};
+
+static inline vec vload(const double* p) {return _mm256_loadu_pd(p);}
+static inline void vstore(double* p, vec v) {_mm256_storeu_pd(p, v);}
+static inline vec vset1(double x) {return _mm256_set1_pd(x);}
+static inline vec vadd(vec a, vec b) {return _mm256_add_pd(a, b);}
+static inline vec vsub(vec a, vec b) {return _mm256_sub_pd(a, b);}
+static inline vec vmul(vec a, vec b) {return _mm256_mul_pd(a, b);}
+static inline vec vdiv(vec a, vec b) {return _mm256_div_pd(a, b);}
+static inline vec vmax(vec acc, vec x) {return _mm256_max_pd(x, acc);}
+static inline vec vmin(vec acc, vec x) {return _mm256_min_pd(x, acc);}
+
+static inline double hsum(vec v) {
+	__m128d	h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+}
+
+static inline double hmax(vec v) {
+	__m128d	h = _mm_max_pd(_mm256_extractf128_pd(v, 1), _mm256_castpd256_pd128(v));
+	return _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(h, h), h));
+}
+
+static inline double hmin(vec v) {
+	__m128d	h = _mm_min_pd(_mm256_extractf128_pd(v, 1), _mm256_castpd256_pd128(v));
+	return _mm_cvtsd_f64(_mm_min_sd(_mm_unpackhi_pd(h, h), h));
+}
+
+#define	KERNELS_NAME	"avx2"
+#include	"vectorkernels.inc"
+#undef	KERNELS_NAME
+
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+
+namespace avx512_kernels {
+
+typedef __m512d	vec;
+enum {width = 8};
+
+static inline vec vload(const double* p) {return _mm512_loadu_pd(p);}
+static inline void vstore(double* p, vec v) {_mm512_storeu_pd(p, v);}
+static inline vec vset1(double x) {return _mm512_set1_pd(x);}
+static inline vec vadd(vec a, vec b) {return _mm512_add_pd(a, b);}
+static inline vec vsub(vec a, vec b) {return _mm512_sub_pd(a, b);}
+static inline vec vmul(vec a, vec b) {return _mm512_mul_pd(a, b);}
+static inline vec vdiv(vec a, vec b) {return _mm512_div_pd(a, b);}
+// Unmasked forms of max, min and extract take _mm*_undefined_*() as the
+// pass-through operand, which GCC 12 reports as uninitialized under -Wall.
+// Masked forms with a defined pass-through and full mask compute the same.
+static inline vec vmax(vec acc, vec x) {return _mm512_mask_max_pd(x, 0xff, x, acc);}
+static inline vec vmin(vec acc, vec x) {return _mm512_mask_min_pd(x, 0xff, x, acc);}
+
+static inline __m256d half(vec v, const int i) {
+	return _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xff, v, i);
+}
+
+// halves are folded and reduced as in AVX2
+static inline double hsum(vec v) {
+	return avx2_kernels::hsum(_mm256_add_pd(half(v, 0), half(v, 1)));
+}
+
+static inline double hmax(vec v) {
+	return avx2_kernels::hmax(_mm256_max_pd(half(v, 1), half(v, 0)));
+}
+
+static inline double hmin(vec v) {
+	return avx2_kernels::hmin(_mm256_min_pd(half(v, 1), half(v, 0)));
+}
+
+#define	KERNELS_NAME	"avx512"
+#include	"vectorkernels.inc"
+#undef	KERNELS_NAME
+
+}
+
+#pragma GCC pop_options
+
+#endif	//	PHLIB_X86_KERNELS
+
+static const VectorKernels* detectVectorKernels()
+{
+#ifdef	PHLIB_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return &avx512_kernels::kernels;
+	if (__builtin_cpu_supports("avx2"))
+		return &avx2_kernels::kernels;
+	if (__builtin_cpu_supports("sse2"))
+		return &sse2_kernels::kernels;
+#endif	//	PHLIB_X86_KERNELS
+	return &scalar_kernels::kernels;
+}
+
+const VectorKernels& vectorKernels()
+{
+	static const VectorKernels* const best = detectVectorKernels();
+	return *best;
+}
+
+const VectorKernels* vectorKernels(const char* isa)
+{
+	if (0 == ::strcmp(isa, scalar_kernels::kernels.name))
+		return &scalar_kernels::kernels;
+
+#ifdef	PHLIB_X86_KERNELS
+	__builtin_cpu_init();
+	if (0 == ::strcmp(isa, sse2_kernels::kernels.name) && __builtin_cpu_supports("sse2"))
+		return &sse2_kernels::kernels;
+	if (0 == ::strcmp(isa, avx2_kernels::kernels.name) && __builtin_cpu_supports("avx2"))
+		return &avx2_kernels::kernels;
+	if (0 == ::strcmp(isa, avx512_kernels::kernels.name) && __builtin_cpu_supports("avx512f"))
+		return &avx512_kernels::kernels;
+#endif	//	PHLIB_X86_KERNELS
+
+	return 0;
+}
+
+}
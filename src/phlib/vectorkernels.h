@@ -0,0 +1,53 @@
+/*
+ * vectorkernels.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Low-level element-wise kernels working on plain arrays of doubles.
+ * Every kernel has a scalar version and, on x86 with GCC, SSE2, AVX2 and
+ * AVX-512 versions. The best set supported by the running CPU is selected
+ * once at first use.
+ */
+
+#ifndef	__MD_VECTORKERNELS_H_584736158736451873465183746
+#define	__MD_VECTORKERNELS_H_584736158736451873465183746
+
+#include	<stddef.h>
+
+namespace phlib {
+
+struct VectorKernels {
+	const char*	name;
+
+	void (*add)(double* dst, const double* src, size_t n);	// dst[i] += src[i]
+	void (*sub)(double* dst, const double* src, size_t n);	// dst[i] -= src[i]
+	void (*scale)(double* dst, size_t n, double mult);	// dst[i] *= mult
+	void (*addMul)(double* dst, const double* src, size_t n, double mult);	// dst[i] += src[i] * mult
+	void (*subDiv)(double* dst, const double* src, size_t n, double divisor);	// dst[i] = (dst[i] - src[i]) / divisor
+	void (*addSquared)(double* dst, const double* src, size_t n);	// dst[i] += src[i] * src[i]
+	void (*linear)(double* dst, size_t n, double shift, double mult, double offset);	// dst[i] = (dst[i] - shift) * mult + offset
+
+	double (*summ)(const double* src, size_t n);
+	double (*max)(const double* src, size_t n);	// n must be positive
+	double (*min)(const double* src, size_t n);	// n must be positive
+};
+
+// kernels best suited for the running CPU
+const VectorKernels& vectorKernels();
+
+// kernels for given instruction set ("scalar", "sse2", "avx2", "avx512")
+// returns 0 if instruction set is unknown or not supported by the CPU
+const VectorKernels* vectorKernels(const char* isa);
+
+}
+
+#endif	//	__MD_VECTORKERNELS_H_584736158736451873465183746
@@ -0,0 +1,32 @@
+/*
+ * test.h --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef	__MD_TEST_H_475610293847561029384756
+#define	__MD_TEST_H_475610293847561029384756
+
+#include	<stdio.h>
+
+// failed checks are reported and counted, the test goes on
+static int	testFailures = 0;
+
+#define	TEST_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			testFailures++; \
+		} \
+	} while (0)
+
+#define	TEST_RESULT()	(testFailures > 0 ? 1 : 0)
+
+#endif	//	__MD_TEST_H_475610293847561029384756
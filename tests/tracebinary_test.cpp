@@ -0,0 +1,91 @@
+/*
+ * tracebinary_test.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<string>
+#include	<vector>
+#include	"test.h"
+#include	"tracebinary.h"
+#include	"tracereader.h"
+#include	"namedexception.h"
+
+using namespace phlib;
+
+// file header followed by one record with crafted header words
+static std::vector<char> craft(unsigned type, unsigned count, unsigned columns, unsigned size)
+{
+	const unsigned	words[] = {1, 0, type, count, columns, size};
+	std::vector<char>	file(8 + sizeof(words) + ((size + 7) & ~7u));
+	::memcpy(&file[0], "PHTRBIN1", 8);
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+		for (int b = 0; b < 4; b++)
+			file[8 + 4 * i + b] = static_cast<char>(words[i] >> (8 * b));
+	return file;
+}
+
+// record is rejected, not passed as rows or titles
+static bool rejected(const std::vector<char>& file)
+{
+	BinaryTraceScanner	scanner(&file[0], &file[0] + file.size());
+	return BinaryTraceScanner::recordEnd == scanner.next() && scanner.damaged();
+}
+
+class CountingReader : public TraceReader {
+public:
+	size_t	values;
+
+	CountingReader() : values(0) {}
+
+protected:
+	virtual void handle(int, double) {
+		values++;
+	}
+};
+
+int main()
+{
+	// rows * columns * 8 wraps to 0 in 64 bits
+	TEST_CHECK(rejected(craft(2, 0x80000000u, 0x40000000u, 0)));
+	TEST_CHECK(rejected(craft(3, 0x80000000u, 0x40000000u, 8)));
+	TEST_CHECK(rejected(craft(2, 0xffffffffu, 0xffffffffu, 8)));
+	TEST_CHECK(rejected(craft(2, 5, 0, 0)));
+	TEST_CHECK(rejected(craft(3, 1, 1000000, 8)));
+	TEST_CHECK(rejected(craft(1, 0xffffffffu, 0, 8)));
+
+	// valid record of 2 rows by 1 column is accepted
+	std::vector<char>	valid = craft(2, 2, 1, 16);
+	BinaryTraceScanner	scanner(&valid[0], &valid[0] + valid.size());
+	TEST_CHECK(BinaryTraceScanner::recordRows == scanner.next());
+	TEST_CHECK(2 == scanner.rows() && 1 == scanner.columns());
+
+	// reader reports damaged file instead of reading beyond it
+	const char*	name = "tracebinary_test.bin";
+	const std::vector<char>	evil = craft(2, 0x80000000u, 0x40000000u, 0);
+	FILE*	f = ::fopen(name, "wb");
+	TEST_CHECK(f && evil.size() == ::fwrite(&evil[0], 1, evil.size(), f));
+	::fclose(f);
+
+	CountingReader	reader;
+	bool	thrown = false;
+	try {
+		reader.read(name);
+	}
+	catch (const NamedException&) {
+		thrown = true;
+	}
+	::remove(name);
+	TEST_CHECK(thrown && 0 == reader.values);
+
+	return TEST_RESULT();
+}
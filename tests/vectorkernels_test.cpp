@@ -0,0 +1,85 @@
+/*
+ * vectorkernels_test.cpp --
+ *
+ * This file is part of phlib library.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include	<math.h>
+#include	<string.h>
+#include	"test.h"
+#include	"vectorkernels.h"
+
+using namespace phlib;
+
+static double sequentialMax(const double* src, size_t n)
+{
+	double	res = src[0];
+	for (size_t i = 1; i < n; i++)
+		if (res < src[i])
+			res = src[i];
+	return res;
+}
+
+static double sequentialMin(const double* src, size_t n)
+{
+	double	res = src[0];
+	for (size_t i = 1; i < n; i++)
+		if (res > src[i])
+			res = src[i];
+	return res;
+}
+
+// same bits, so signs of zeros and NaN are compared as well
+static bool same(double a, double b)
+{
+	return 0 == ::memcmp(&a, &b, sizeof(double));
+}
+
+static void check(const VectorKernels& k, const double* src, size_t n)
+{
+	TEST_CHECK(same(k.max(src, n), sequentialMax(src, n)));
+	TEST_CHECK(same(k.min(src, n), sequentialMin(src, n)));
+}
+
+int main()
+{
+	const char*	sets[] = {"scalar", "sse2", "avx2", "avx512"};
+	enum {Size = 37};
+	double	v[Size];
+
+	for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+		const VectorKernels*	k = vectorKernels(sets[s]);
+		if (!k)
+			continue;	// not supported by CPU
+
+		for (size_t n = 1; n <= Size; n++) {
+			for (size_t i = 0; i < n; i++)
+				v[i] = ((i * 7919) % 23) - 11.5;
+			check(*k, v, n);
+
+			// NaN in every position, the middle of a lane included
+			for (size_t pos = 0; pos < n; pos++) {
+				const double	saved = v[pos];
+				v[pos] = NAN;
+				check(*k, v, n);
+				v[pos] = saved;
+			}
+
+			// equal zeros of different signs as extremes
+			for (size_t i = 0; i < n; i++)
+				v[i] = i % 2 ? -0.0 : 0.0;
+			check(*k, v, n);
+			v[0] = -0.0;
+			check(*k, v, n);
+		}
+	}
+
+	return TEST_RESULT();
+}